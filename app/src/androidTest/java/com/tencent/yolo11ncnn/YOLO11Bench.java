@@ -0,0 +1,35 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2025 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+package com.tencent.yolo11ncnn;
+
+import android.content.res.AssetManager;
+
+// libyolo11bench is only in debug builds, see YOLO11NCNN_BENCHMARK in jni/CMakeLists.txt
+public class YOLO11Bench
+{
+    public native String benchmarkBatch(AssetManager mgr, int taskid, int modelid, int cpugpu, int count);
+    public native String stressTest(AssetManager mgr, int taskid, int modelid, int cpugpu, int threads, int iterations);
+    public native String checkFoldParity(AssetManager mgr, int taskid, int modelid, int cpugpu);
+    public native String benchmarkLoad(AssetManager mgr, int taskid, int cpugpu, String cacheDir);
+    public native String checkAsync(AssetManager mgr, int taskid, int modelid, int cpugpu);
+    public native String benchmarkHeadLayout(AssetManager mgr, int modelid, int cpugpu, int count);
+    public native String benchmarkDfl(int count);
+    public native String benchmarkNms(AssetManager mgr, int modelid, int cpugpu, int count);
+    public native String benchmarkTiled(AssetManager mgr, int taskid, int modelid, int cpugpu, int count);
+
+    static {
+        System.loadLibrary("yolo11bench");
+    }
+}
@@ -0,0 +1,131 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2025 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+package com.tencent.yolo11ncnn;
+
+import android.content.res.AssetManager;
+import android.test.InstrumentationTestCase;
+import android.util.Log;
+
+// ./gradlew connectedDebugAndroidTest, needs the model weights in app/src/main/assets
+public class YOLO11BenchTest extends InstrumentationTestCase
+{
+    // det n-320 on cpu
+    private static final int TASK_DET = 0;
+    private static final int MODEL_N_320 = 0;
+    private static final int CPU = 0;
+
+    private YOLO11Bench bench = new YOLO11Bench();
+
+    private AssetManager getAssets()
+    {
+        return getInstrumentation().getTargetContext().getAssets();
+    }
+
+    public void testBenchmarkBatch()
+    {
+        String text = bench.benchmarkBatch(getAssets(), TASK_DET, MODEL_N_320, CPU, 8);
+        Log.i("YOLO11BenchTest", text);
+
+        assertTrue(text.startsWith("sequential"));
+        assertTrue(text.contains("batch x1"));
+    }
+
+    // several threads detecting on one shared net must get the results of a lone detect
+    public void testStress()
+    {
+        String text = bench.stressTest(getAssets(), TASK_DET, MODEL_N_320, CPU, 4, 32);
+        Log.i("YOLO11BenchTest", text);
+
+        assertTrue(text.startsWith("stress x4"));
+        assertTrue(text.endsWith("mismatches 0"));
+    }
+
+    // the 1/255 folded into the first convolution must detect like the cpu normalization, for every task
+    public void testFoldParity()
+    {
+        for (int taskid = 0; taskid < 5; taskid++)
+        {
+            String text = bench.checkFoldParity(getAssets(), taskid, MODEL_N_320, CPU);
+            Log.i("YOLO11BenchTest", text);
+
+            assertTrue(text.startsWith("fold parity"));
+            assertTrue(text.contains("mismatches 0 "));
+        }
+    }
+
+    // loads from assets, then filling and hitting the rewrite cache, for n s m
+    public void testBenchmarkLoad()
+    {
+        String cacheDir = getInstrumentation().getTargetContext().getCacheDir().getAbsolutePath() + "/rewrite-bench";
+        String text = bench.benchmarkLoad(getAssets(), TASK_DET, CPU, cacheDir);
+        Log.i("YOLO11BenchTest", text);
+
+        assertTrue(text.startsWith("load n"));
+        assertTrue(text.contains("load m"));
+    }
+
+    // drop-oldest backpressure, blocking submits, an expired deadline and cancel on shutdown
+    public void testAsync()
+    {
+        String text = bench.checkAsync(getAssets(), TASK_DET, MODEL_N_320, CPU);
+        Log.i("YOLO11BenchTest", text);
+
+        assertTrue(text.startsWith("async"));
+        assertTrue(text.endsWith("failures 0"));
+    }
+
+    // the class-major split head must detect like the anchor-major fused decode, at both thresholds
+    public void testHeadLayout()
+    {
+        String text = bench.benchmarkHeadLayout(getAssets(), MODEL_N_320, CPU, 8);
+        Log.i("YOLO11BenchTest", text);
+
+        assertTrue(text.startsWith("anchor-major"));
+        assertEquals(2, text.split("mismatches 0\n", -1).length - 1);
+    }
+
+    // the shared dfl decode against the softmax layer it replaced
+    public void testDfl()
+    {
+        String text = bench.benchmarkDfl(4096);
+        Log.i("YOLO11BenchTest", text);
+
+        assertTrue(text.startsWith("dfl 4096 anchors"));
+
+        float maxDiff = Float.parseFloat(text.substring(text.lastIndexOf(' ') + 1));
+        assertTrue(maxDiff < 1e-3f);
+    }
+
+    // the grid nms must keep what the pairwise one did, on crowded synthetic sets and on sets a det model produced
+    public void testNms()
+    {
+        String text = bench.benchmarkNms(getAssets(), MODEL_N_320, CPU, 4);
+        Log.i("YOLO11BenchTest", text);
+
+        assertTrue(text.startsWith("nms 16 synthetic"));
+        assertTrue(text.contains(" recorded "));
+        assertEquals(2, text.split("mismatches 0\n", -1).length - 1);
+    }
+
+    public void testTiled()
+    {
+        String text = bench.benchmarkTiled(getAssets(), TASK_DET, MODEL_N_320, CPU, 4);
+        Log.i("YOLO11BenchTest", text);
+
+        assertTrue(text.startsWith("whole "));
+        assertTrue(text.contains("\ntiled "));
+        assertTrue(text.contains("\ntiled+coarse "));
+    }
+}
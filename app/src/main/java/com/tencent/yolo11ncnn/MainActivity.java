@@ -131,6 +131,8 @@ public class MainActivity extends Activity implements SurfaceHolder.Callback
             }
         });
 
+        yolo11ncnn.setRewriteCacheDir(getCacheDir().getAbsolutePath() + "/rewrite");
+
         reload();
     }
 
@@ -179,4 +181,12 @@ public class MainActivity extends Activity implements SurfaceHolder.Callback
 
         yolo11ncnn.closeCamera();
     }
+
+    @Override
+    public void onTrimMemory(int level)
+    {
+        super.onTrimMemory(level);
+
+        yolo11ncnn.trimMemory(level);
+    }
 }
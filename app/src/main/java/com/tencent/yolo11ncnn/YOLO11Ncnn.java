@@ -20,6 +20,24 @@ import android.view.Surface;
 public class YOLO11Ncnn
 {
     public native boolean loadModel(AssetManager mgr, int taskid, int modelid, int cpugpu);
+    public native boolean loadSecondaryModel(AssetManager mgr, int taskid, int modelid, int cpugpu);
+    public native boolean setCascadeCropBudget(int crops);
+    public native boolean setCascadeLabelMap(int[] map);
+    public native boolean setEscalation(float low, float high, float coverage);
+    public native String getEscalationStats();
+    public native boolean setTiled(boolean enable, float overlap);
+    public native boolean setAsyncDetect(boolean enable);
+    public native boolean setIncremental(boolean enable, float threshold, float coverage);
+    public native boolean setClassSubset(int[] classes);
+    public native boolean setDetectFilter(float probThreshold, int maxCandidates);
+    public native String getIncrementalStats();
+    public native boolean preloadModel(AssetManager mgr, int taskid, int modelid, int cpugpu);
+    public native boolean setModelCacheBudget(int megabytes);
+    public native boolean setRewriteCacheDir(String dir);
+    public native boolean trimMemory(int level);
+    public native boolean setAdaptiveSize(float budgetms, int minsize, int maxsize);
+    public native int getDetTargetSize();
+    public native String getSizeHistory();
     public native boolean openCamera(int facing);
     public native boolean closeCamera();
     public native boolean setOutputWindow(Surface surface);
@@ -0,0 +1,328 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2025 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "modelcache.h"
+
+#include <android/log.h>
+
+#include <algorithm>
+#include <stdio.h>
+#include <string>
+#include <unistd.h>
+
+#include <benchmark.h>
+
+static ncnn::Mutex rewrite_cache_lock;
+static std::string rewrite_cache_dir;
+
+// resident set size in KB, for comparing model load paths
+static long get_rss_kb()
+{
+    FILE* fp = fopen("/proc/self/statm", "r");
+    if (!fp)
+        return 0;
+
+    long size = 0;
+    long resident = 0;
+    int nscan = fscanf(fp, "%ld %ld", &size, &resident);
+    fclose(fp);
+
+    if (nscan != 2)
+        return 0;
+
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+bool ModelKey::operator==(const ModelKey& key) const
+{
+    return taskid == key.taskid && modeltype == key.modeltype && use_int8 == key.use_int8 && backend == key.backend;
+}
+
+ModelCache::ModelCache()
+{
+    budget = 0;
+
+    preload_thread = 0;
+    preload_mgr = 0;
+}
+
+ModelCache::~ModelCache()
+{
+    wait_preload();
+    clear();
+}
+
+void ModelCache::set_budget(size_t _budget)
+{
+    ncnn::MutexLockGuard g(lock);
+
+    budget = _budget;
+    evict(budget);
+}
+
+std::shared_ptr<YOLO11> ModelCache::get(const ModelKey& key)
+{
+    ncnn::MutexLockGuard g(lock);
+
+    for (std::list<Entry>::iterator it = entries.begin(); it != entries.end(); it++)
+    {
+        if (it->key == key)
+        {
+            entries.splice(entries.begin(), entries, it);
+            return entries.front().yolo11;
+        }
+    }
+
+    return std::shared_ptr<YOLO11>();
+}
+
+void ModelCache::put(const ModelKey& key, const std::shared_ptr<YOLO11>& yolo11)
+{
+    insert(key, yolo11, true);
+}
+
+void ModelCache::trim(int level)
+{
+    ncnn::MutexLockGuard g(lock);
+
+    // TRIM_MEMORY_RUNNING_CRITICAL and above, keep only the model in use
+    if (level >= 15)
+    {
+        evict(1);
+        return;
+    }
+
+    // TRIM_MEMORY_RUNNING_MODERATE / TRIM_MEMORY_RUNNING_LOW
+    if (level >= 5)
+    {
+        size_t total = 0;
+        for (std::list<Entry>::const_iterator it = entries.begin(); it != entries.end(); it++)
+        {
+            total += it->size;
+        }
+
+        evict(std::max(total / 2, (size_t)1));
+    }
+}
+
+void ModelCache::evict_gpu()
+{
+    ncnn::MutexLockGuard g(lock);
+
+    std::list<Entry>::iterator it = entries.begin();
+    while (it != entries.end())
+    {
+        if (it->key.backend != 0)
+        {
+            it = entries.erase(it);
+        }
+        else
+        {
+            it++;
+        }
+    }
+}
+
+void ModelCache::clear()
+{
+    ncnn::MutexLockGuard g(lock);
+
+    entries.clear();
+}
+
+void ModelCache::preload(AAssetManager* mgr, const ModelKey& key)
+{
+    wait_preload();
+
+    {
+        ncnn::MutexLockGuard g(lock);
+
+        for (std::list<Entry>::const_iterator it = entries.begin(); it != entries.end(); it++)
+        {
+            if (it->key == key)
+                return;
+        }
+    }
+
+    preload_mgr = mgr;
+    preload_key = key;
+    preload_thread = new ncnn::Thread(preload_entry, this);
+}
+
+void ModelCache::wait_preload()
+{
+    if (!preload_thread)
+        return;
+
+    preload_thread->join();
+    delete preload_thread;
+    preload_thread = 0;
+}
+
+void ModelCache::set_rewrite_cache_dir(const std::string& dir)
+{
+    ncnn::MutexLockGuard g(rewrite_cache_lock);
+
+    rewrite_cache_dir = dir;
+}
+
+void ModelCache::model_paths(const ModelKey& key, std::string& parampath, std::string& modelpath)
+{
+    const char* tasknames[5] =
+    {
+        "",
+        "_seg",
+        "_pose",
+        "_cls",
+        "_obb"
+    };
+
+    const char* modeltypes[3] =
+    {
+        "n",
+        "s",
+        "m"
+    };
+
+    const char* precision = key.use_int8 ? "_int8" : "";
+
+    parampath = std::string("yolo11") + modeltypes[key.modeltype] + tasknames[key.taskid] + precision + ".ncnn.param";
+    modelpath = std::string("yolo11") + modeltypes[key.modeltype] + tasknames[key.taskid] + precision + ".ncnn.bin";
+}
+
+bool ModelCache::has_assets(AAssetManager* mgr, const ModelKey& key)
+{
+    std::string parampath;
+    std::string modelpath;
+    model_paths(key, parampath, modelpath);
+
+    AAsset* param = AAssetManager_open(mgr, parampath.c_str(), AASSET_MODE_UNKNOWN);
+    AAsset* model = AAssetManager_open(mgr, modelpath.c_str(), AASSET_MODE_UNKNOWN);
+
+    const bool found = param && model;
+
+    if (param)
+        AAsset_close(param);
+    if (model)
+        AAsset_close(model);
+
+    return found;
+}
+
+YOLO11* ModelCache::create(AAssetManager* mgr, const ModelKey& key, bool fold_normalize, bool use_rewrite_cache)
+{
+    std::string parampath;
+    std::string modelpath;
+    model_paths(key, parampath, modelpath);
+
+    YOLO11* yolo11 = 0;
+    if (key.taskid == 0) yolo11 = new YOLO11_det;
+    if (key.taskid == 1) yolo11 = new YOLO11_seg;
+    if (key.taskid == 2) yolo11 = new YOLO11_pose;
+    if (key.taskid == 3) yolo11 = new YOLO11_cls;
+    if (key.taskid == 4) yolo11 = new YOLO11_obb;
+
+    yolo11->set_fold_normalize(fold_normalize);
+
+    if (use_rewrite_cache)
+    {
+        ncnn::MutexLockGuard g(rewrite_cache_lock);
+
+        yolo11->set_rewrite_cache(rewrite_cache_dir);
+    }
+
+    long rss0 = get_rss_kb();
+    double t0 = ncnn::get_current_time();
+
+    int ret = yolo11->load(mgr, parampath.c_str(), modelpath.c_str(), key.backend != 0);
+
+    double t1 = ncnn::get_current_time();
+    long rss1 = get_rss_kb();
+
+    __android_log_print(ANDROID_LOG_DEBUG, "ncnn", "load %s %.2fms rss %ldKB -> %ldKB", modelpath.c_str(), t1 - t0, rss0, rss1);
+
+    if (ret != 0)
+    {
+        __android_log_print(ANDROID_LOG_ERROR, "ncnn", "load %s failed", parampath.c_str());
+
+        delete yolo11;
+        return 0;
+    }
+
+    return yolo11;
+}
+
+void ModelCache::insert(const ModelKey& key, const std::shared_ptr<YOLO11>& yolo11, bool most_recent)
+{
+    ncnn::MutexLockGuard g(lock);
+
+    for (std::list<Entry>::const_iterator it = entries.begin(); it != entries.end(); it++)
+    {
+        // loaded twice, keep the one that may already be in use
+        if (it->key == key)
+            return;
+    }
+
+    Entry entry;
+    entry.key = key;
+    entry.yolo11 = yolo11;
+    entry.size = yolo11->get_weights_size();
+
+    if (most_recent || entries.empty())
+    {
+        entries.push_front(entry);
+    }
+    else
+    {
+        entries.insert(++entries.begin(), entry);
+    }
+
+    evict(budget);
+}
+
+void ModelCache::evict(size_t _budget)
+{
+    if (_budget == 0)
+        return;
+
+    size_t total = 0;
+    for (std::list<Entry>::const_iterator it = entries.begin(); it != entries.end(); it++)
+    {
+        total += it->size;
+    }
+
+    // never evict the front, it is the model being rendered
+    while (total > _budget && entries.size() > 1)
+    {
+        Entry& entry = entries.back();
+
+        __android_log_print(ANDROID_LOG_DEBUG, "ncnn", "evict model task %d type %d", entry.key.taskid, entry.key.modeltype);
+
+        total -= entry.size;
+        entries.pop_back();
+    }
+}
+
+void* ModelCache::preload_entry(void* args)
+{
+    ModelCache* cache = (ModelCache*)args;
+
+    std::shared_ptr<YOLO11> yolo11(create(cache->preload_mgr, cache->preload_key));
+    if (yolo11)
+    {
+        cache->insert(cache->preload_key, yolo11, false);
+    }
+
+    return 0;
+}
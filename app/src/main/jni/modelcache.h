@@ -0,0 +1,102 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2025 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef MODELCACHE_H
+#define MODELCACHE_H
+
+#include <list>
+#include <memory>
+#include <string>
+
+#include <platform.h>
+
+#include "yolo11.h"
+
+struct ModelKey
+{
+    int taskid;    // 0=det 1=seg 2=pose 3=cls 4=obb
+    int modeltype; // 0=n 1=s 2=m
+    bool use_int8;
+    int backend;   // 0=cpu 1=gpu 2=turnip
+
+    bool operator==(const ModelKey& key) const;
+};
+
+// LRU cache of loaded models, so switching task or model is a pointer swap
+// the most recently used model is the one being rendered and is never evicted
+// entries are shared, an evicted model lives on until its last frame releases it
+class ModelCache
+{
+public:
+    ModelCache();
+    ~ModelCache();
+
+    // estimated bytes of model weights to keep loaded, 0 means unlimited
+    void set_budget(size_t budget);
+
+    // returns null on miss, a hit becomes the most recently used model
+    std::shared_ptr<YOLO11> get(const ModelKey& key);
+
+    // makes it the most recently used model
+    void put(const ModelKey& key, const std::shared_ptr<YOLO11>& yolo11);
+
+    // shrink for ComponentCallbacks2.onTrimMemory level
+    void trim(int level);
+
+    // drop every model living on the vulkan device, before the gpu instance is recreated
+    void evict_gpu();
+
+    void clear();
+
+    // load key on a background thread and keep it behind the most recently used model
+    void preload(AAssetManager* mgr, const ModelKey& key);
+    void wait_preload();
+
+    // new model for key, loaded from assets, 0 on failure
+    // fold_normalize false keeps the 1/255 pass on the cpu, parity checks load both
+    // use_rewrite_cache false loads from assets alone, for timing the uncached path
+    static YOLO11* create(AAssetManager* mgr, const ModelKey& key, bool fold_normalize = true, bool use_rewrite_cache = true);
+
+    // whether the param and bin of key are packaged, int8 variants are built by tools/yolo11_int8.py
+    static bool has_assets(AAssetManager* mgr, const ModelKey& key);
+
+    // asset names of the param and bin of key
+    static void model_paths(const ModelKey& key, std::string& parampath, std::string& modelpath);
+
+    // where create keeps rewritten graphs and their fp32 weights across runs, empty disables
+    static void set_rewrite_cache_dir(const std::string& dir);
+
+private:
+    struct Entry
+    {
+        ModelKey key;
+        std::shared_ptr<YOLO11> yolo11;
+        size_t size;
+    };
+
+    void insert(const ModelKey& key, const std::shared_ptr<YOLO11>& yolo11, bool most_recent);
+    void evict(size_t budget);
+
+    static void* preload_entry(void* args);
+
+    ncnn::Mutex lock;
+    std::list<Entry> entries;
+    size_t budget;
+
+    ncnn::Thread* preload_thread;
+    AAssetManager* preload_mgr;
+    ModelKey preload_key;
+};
+
+#endif // MODELCACHE_H
@@ -0,0 +1,1012 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2025 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "modelrewrite.h"
+
+#include <android/log.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <datareader.h>
+#include <mat.h>
+
+static inline size_t align_size(size_t size, size_t n)
+{
+    return (size + n - 1) & -n;
+}
+
+static void split_tokens(const char* line, size_t length, std::vector<std::string>& tokens)
+{
+    tokens.clear();
+
+    size_t i = 0;
+    while (i < length)
+    {
+        while (i < length && (line[i] == ' ' || line[i] == '\t' || line[i] == '\r'))
+            i++;
+
+        size_t j = i;
+        while (j < length && line[j] != ' ' && line[j] != '\t' && line[j] != '\r')
+            j++;
+
+        if (j > i)
+            tokens.push_back(std::string(line + i, j - i));
+
+        i = j;
+    }
+}
+
+// serves the blobs in load order, untouched ones straight from the bin
+class RewriteDataReader : public ncnn::DataReader
+{
+public:
+    RewriteDataReader(const std::vector<std::pair<const unsigned char*, size_t> >& _segments)
+        : segments(_segments), segment(0), pos(0)
+    {
+    }
+
+    virtual int scan(const char* format, void* p) const
+    {
+        return 0;
+    }
+
+    virtual size_t read(void* buf, size_t size) const
+    {
+        unsigned char* out = (unsigned char*)buf;
+
+        size_t nread = 0;
+        while (nread < size && segment < segments.size())
+        {
+            const size_t n = std::min(size - nread, segments[segment].second - pos);
+            memcpy(out + nread, segments[segment].first + pos, n);
+            nread += n;
+            advance(n);
+        }
+
+        return nread;
+    }
+
+    virtual size_t reference(size_t size, const void** buf) const
+    {
+        // a blob never straddles two segments, ModelBin falls back to read otherwise
+        if (segment >= segments.size() || pos + size > segments[segment].second)
+            return 0;
+
+        *buf = segments[segment].first + pos;
+        advance(size);
+        return size;
+    }
+
+private:
+    void advance(size_t n) const
+    {
+        pos += n;
+        if (pos == segments[segment].second)
+        {
+            segment++;
+            pos = 0;
+        }
+    }
+
+    const std::vector<std::pair<const unsigned char*, size_t> >& segments;
+    mutable size_t segment;
+    mutable size_t pos;
+};
+
+int ParamLayer::get_int(int id, int default_value) const
+{
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        if (values[i].first == id)
+            return atoi(values[i].second.c_str());
+    }
+
+    return default_value;
+}
+
+float ParamLayer::get_float(int id, float default_value) const
+{
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        if (values[i].first == id)
+            return (float)atof(values[i].second.c_str());
+    }
+
+    return default_value;
+}
+
+void ParamLayer::set_int(int id, int value)
+{
+    char text[32];
+    sprintf(text, "%d", value);
+
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        if (values[i].first == id)
+        {
+            values[i].second = text;
+            return;
+        }
+    }
+
+    values.push_back(std::make_pair(id, std::string(text)));
+}
+
+int ModelRewriter::parse_param(const char* param)
+{
+    layers.clear();
+
+    std::vector<std::vector<std::string> > lines;
+    {
+        const char* p = param;
+        while (*p)
+        {
+            const char* end = strchr(p, '\n');
+            const size_t length = end ? end - p : strlen(p);
+
+            std::vector<std::string> tokens;
+            split_tokens(p, length, tokens);
+            if (!tokens.empty())
+                lines.push_back(tokens);
+
+            p += length;
+            if (*p == '\n')
+                p++;
+        }
+    }
+
+    if (lines.size() < 2 || lines[0][0] != "7767517" || lines[1].size() != 2)
+        return -1;
+
+    const int layer_count = atoi(lines[1][0].c_str());
+    if ((int)lines.size() != layer_count + 2)
+        return -1;
+
+    layers.resize(layer_count);
+    for (int i = 0; i < layer_count; i++)
+    {
+        const std::vector<std::string>& tokens = lines[i + 2];
+        if (tokens.size() < 4)
+            return -1;
+
+        ParamLayer& layer = layers[i];
+        layer.type = tokens[0];
+        layer.name = tokens[1];
+
+        const int bottom_count = atoi(tokens[2].c_str());
+        const int top_count = atoi(tokens[3].c_str());
+        if ((int)tokens.size() < 4 + bottom_count + top_count)
+            return -1;
+
+        layer.bottoms.assign(tokens.begin() + 4, tokens.begin() + 4 + bottom_count);
+        layer.tops.assign(tokens.begin() + 4 + bottom_count, tokens.begin() + 4 + bottom_count + top_count);
+
+        for (size_t j = 4 + bottom_count + top_count; j < tokens.size(); j++)
+        {
+            const size_t eq = tokens[j].find('=');
+            if (eq == std::string::npos)
+                return -1;
+
+            layer.values.push_back(std::make_pair(atoi(tokens[j].substr(0, eq).c_str()), tokens[j].substr(eq + 1)));
+        }
+    }
+
+    return 0;
+}
+
+int ModelRewriter::parse(const char* param, const unsigned char* _bin, size_t _bin_size)
+{
+    bin = _bin;
+    bin_size = _bin_size;
+    weights.clear();
+
+    if (parse_param(param) != 0)
+        return -1;
+
+    const int layer_count = (int)layers.size();
+
+    // walk the bin the way each layer's load_model reads it
+    weights.resize(layer_count);
+    size_t offset = 0;
+    for (int i = 0; i < layer_count; i++)
+    {
+        const ParamLayer& layer = layers[i];
+
+        // loads of this layer, count and whether it carries a storage flag
+        std::vector<std::pair<int, bool> > loads;
+
+        if (layer.type == "Convolution" || layer.type == "ConvolutionDepthWise" || layer.type == "Deconvolution")
+        {
+            const int num_output = layer.get_int(0, 0);
+            const int bias_term = layer.get_int(5, 0);
+            const int weight_data_size = layer.get_int(6, 0);
+            const int int8_scale_term = layer.get_int(8, 0);
+            const int dynamic_weight = layer.get_int(layer.type == "Deconvolution" ? 28 : 19, 0);
+            if (dynamic_weight)
+                continue;
+
+            loads.push_back(std::make_pair(weight_data_size, true));
+            if (bias_term)
+                loads.push_back(std::make_pair(num_output, false));
+
+            if (layer.type == "Convolution" && int8_scale_term)
+            {
+                loads.push_back(std::make_pair(num_output, false));
+                loads.push_back(std::make_pair(1, false));
+            }
+            if (layer.type == "ConvolutionDepthWise" && (int8_scale_term == 1 || int8_scale_term == 101))
+            {
+                loads.push_back(std::make_pair(layer.get_int(7, 1), false));
+                loads.push_back(std::make_pair(1, false));
+            }
+            if (layer.type == "ConvolutionDepthWise" && (int8_scale_term == 2 || int8_scale_term == 102))
+            {
+                loads.push_back(std::make_pair(1, false));
+                loads.push_back(std::make_pair(1, false));
+            }
+            if (layer.type != "Deconvolution" && int8_scale_term > 100)
+                loads.push_back(std::make_pair(1, false));
+        }
+        else if (layer.type == "InnerProduct")
+        {
+            const int num_output = layer.get_int(0, 0);
+            const int bias_term = layer.get_int(1, 0);
+            const int weight_data_size = layer.get_int(2, 0);
+            const int int8_scale_term = layer.get_int(8, 0);
+
+            loads.push_back(std::make_pair(weight_data_size, true));
+            if (bias_term)
+                loads.push_back(std::make_pair(num_output, false));
+            if (int8_scale_term)
+            {
+                loads.push_back(std::make_pair(num_output, false));
+                loads.push_back(std::make_pair(1, false));
+            }
+        }
+
+        for (size_t j = 0; j < loads.size(); j++)
+        {
+            WeightBlob blob;
+            blob.offset = offset;
+            blob.count = loads[j].first;
+            blob.storage = WeightBlob::RAW;
+            blob.size = blob.count * sizeof(float);
+
+            if (loads[j].second)
+            {
+                if (offset + 4 > bin_size)
+                    return -1;
+
+                const unsigned char* flag = bin + offset;
+                unsigned int tag;
+                memcpy(&tag, flag, 4);
+
+                if (tag == 0x01306B47)
+                {
+                    blob.storage = WeightBlob::FP16;
+                    blob.size = 4 + align_size(blob.count * sizeof(unsigned short), 4);
+                }
+                else if (tag == 0x000D4B38)
+                {
+                    blob.storage = WeightBlob::INT8;
+                    blob.size = 4 + align_size(blob.count, 4);
+                }
+                else if (tag == 0x0002C056 || flag[0] + flag[1] + flag[2] + flag[3] == 0)
+                {
+                    blob.storage = WeightBlob::FP32;
+                    blob.size = 4 + blob.count * sizeof(float);
+                }
+                else
+                {
+                    blob.storage = WeightBlob::QUANTIZED;
+                    blob.size = 4 + 256 * sizeof(float) + align_size(blob.count, 4);
+                }
+            }
+
+            offset += blob.size;
+            if (offset > bin_size)
+                return -1;
+
+            weights[i].push_back(blob);
+        }
+    }
+
+    // a weighted layer type not handled above would leave bytes over
+    if (offset != bin_size)
+    {
+        __android_log_print(ANDROID_LOG_WARN, "ncnn", "rewrite accounted %zu of %zu weight bytes", offset, bin_size);
+        return -1;
+    }
+
+    return 0;
+}
+
+int ModelRewriter::find_layer_reading(const std::string& blob) const
+{
+    int found = -1;
+    for (size_t i = 0; i < layers.size(); i++)
+    {
+        for (size_t j = 0; j < layers[i].bottoms.size(); j++)
+        {
+            if (layers[i].bottoms[j] != blob)
+                continue;
+
+            if (found != -1)
+                return -1;
+
+            found = (int)i;
+        }
+    }
+
+    return found;
+}
+
+int ModelRewriter::find_layer_writing(const std::string& blob) const
+{
+    for (size_t i = 0; i < layers.size(); i++)
+    {
+        const std::vector<std::string>& tops = layers[i].tops;
+        if (std::find(tops.begin(), tops.end(), blob) != tops.end())
+            return (int)i;
+    }
+
+    return -1;
+}
+
+static bool is_local_layer(const ParamLayer& layer)
+{
+    const std::string& type = layer.type;
+
+    if (type == "Input" || type == "Convolution" || type == "ConvolutionDepthWise" || type == "Split" || type == "Padding")
+        return true;
+
+    if (type == "Swish" || type == "Sigmoid" || type == "ReLU" || type == "BinaryOp" || type == "Eltwise")
+        return true;
+
+    // channel axis only
+    if (type == "Concat" || type == "Slice")
+        return layer.get_int(type == "Concat" ? 0 : 1, 0) == 0;
+
+    if (type == "Pooling")
+        return layer.get_int(4, 0) == 0;
+
+    return false;
+}
+
+int ModelRewriter::find_local_cut(std::vector<std::string>& blobs, std::vector<int>& radii) const
+{
+    blobs.clear();
+    radii.clear();
+
+    size_t first_global = 0;
+    while (first_global < layers.size() && is_local_layer(layers[first_global]))
+        first_global++;
+
+    if (first_global == layers.size())
+        return -1;
+
+    std::set<std::string> inputs;
+    std::set<std::string> produced;
+    for (size_t i = 0; i < first_global; i++)
+    {
+        if (layers[i].type == "Input")
+            inputs.insert(layers[i].tops.begin(), layers[i].tops.end());
+        else
+            produced.insert(layers[i].tops.begin(), layers[i].tops.end());
+    }
+
+    std::set<std::string> seen;
+    for (size_t i = first_global; i < layers.size(); i++)
+    {
+        for (size_t j = 0; j < layers[i].bottoms.size(); j++)
+        {
+            const std::string& blob = layers[i].bottoms[j];
+
+            // the tail would need the raw input again
+            if (inputs.count(blob))
+                return -1;
+
+            if (produced.count(blob) && !seen.count(blob))
+            {
+                blobs.push_back(blob);
+                seen.insert(blob);
+            }
+        }
+    }
+
+    if (blobs.empty())
+        return -1;
+
+    // receptive field radius and stride of every front blob, in input pixels
+    std::map<std::string, std::pair<int, int> > fields;
+    for (size_t i = 0; i < first_global; i++)
+    {
+        const ParamLayer& layer = layers[i];
+
+        int r = 0;
+        int s = 1;
+        for (size_t j = 0; j < layer.bottoms.size(); j++)
+        {
+            std::map<std::string, std::pair<int, int> >::const_iterator it = fields.find(layer.bottoms[j]);
+            if (it == fields.end())
+                continue;
+
+            r = std::max(r, it->second.first);
+            s = std::max(s, it->second.second);
+        }
+
+        int extent = 0;
+        int stride = 1;
+        if (layer.type == "Convolution" || layer.type == "ConvolutionDepthWise")
+        {
+            const int kernel_w = layer.get_int(1, 0);
+            const int kernel_h = layer.get_int(11, kernel_w);
+            const int dilation_w = layer.get_int(2, 1);
+            const int dilation_h = layer.get_int(12, dilation_w);
+            const int stride_w = layer.get_int(3, 1);
+            const int stride_h = layer.get_int(13, stride_w);
+            extent = std::max((kernel_w - 1) * dilation_w, (kernel_h - 1) * dilation_h);
+            stride = std::max(stride_w, stride_h);
+        }
+        if (layer.type == "Pooling")
+        {
+            const int kernel_w = layer.get_int(1, 0);
+            const int kernel_h = layer.get_int(11, kernel_w);
+            const int stride_w = layer.get_int(2, 1);
+            const int stride_h = layer.get_int(12, stride_w);
+            extent = std::max(kernel_w - 1, kernel_h - 1);
+            stride = std::max(stride_w, stride_h);
+        }
+
+        r += (extent + 1) / 2 * s;
+        s *= std::max(stride, 1);
+
+        for (size_t j = 0; j < layer.tops.size(); j++)
+        {
+            fields[layer.tops[j]] = std::make_pair(r, s);
+        }
+    }
+
+    radii.resize(blobs.size());
+    for (size_t i = 0; i < blobs.size(); i++)
+    {
+        radii[i] = fields[blobs[i]].first;
+    }
+
+    return 0;
+}
+
+int ModelRewriter::fold_input_scale(float scale)
+{
+    int input = -1;
+    for (size_t i = 0; i < layers.size(); i++)
+    {
+        if (layers[i].type != "Input")
+            continue;
+
+        if (input != -1)
+            return -1;
+
+        input = (int)i;
+    }
+
+    if (input == -1 || layers[input].tops.size() != 1)
+        return -1;
+
+    const int conv = find_layer_reading(layers[input].tops[0]);
+    if (conv == -1 || layers[conv].type != "Convolution" || weights[conv].empty())
+        return -1;
+
+    // zero padding is zero at any input scale, any other pad value is not
+    if (layers[conv].get_float(18, 0.f) != 0.f)
+        return -1;
+
+    const WeightBlob& weight = weights[conv][0];
+
+    if (weight.storage == WeightBlob::INT8)
+    {
+        // x * scale quantizes with bottom_scale, dequantize divides by weight_scale * bottom_scale
+        // bottom_scale * scale and weight_scale / scale give the same int8 input and the same output
+        const int bias_term = layers[conv].get_int(5, 0);
+        if ((int)weights[conv].size() < 3 + bias_term)
+            return -1;
+
+        std::vector<float> weight_scales;
+        std::vector<float> bottom_scales;
+        read_floats(conv, 1 + bias_term, weight_scales);
+        read_floats(conv, 2 + bias_term, bottom_scales);
+
+        for (size_t i = 0; i < weight_scales.size(); i++)
+        {
+            weight_scales[i] /= scale;
+        }
+        for (size_t i = 0; i < bottom_scales.size(); i++)
+        {
+            bottom_scales[i] *= scale;
+        }
+
+        write_floats(conv, 1 + bias_term, weight_scales);
+        write_floats(conv, 2 + bias_term, bottom_scales);
+
+        return 0;
+    }
+
+    std::vector<float> values;
+    if (read_floats(conv, 0, values) != 0)
+        return -1;
+
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        values[i] *= scale;
+    }
+
+    // fp16 weights come back as fp32, the first convolution is only a few hundred values
+    write_floats(conv, 0, values);
+
+    return 0;
+}
+
+int ModelRewriter::read_floats(int layer_index, int blob_index, std::vector<float>& values) const
+{
+    const WeightBlob& blob = weights[layer_index][blob_index];
+
+    const unsigned char* p = blob.data.empty() ? bin + blob.offset : &blob.data[0];
+
+    values.resize(blob.count);
+
+    if (blob.storage == WeightBlob::RAW)
+    {
+        memcpy(&values[0], p, blob.count * sizeof(float));
+        return 0;
+    }
+
+    if (blob.storage == WeightBlob::FP32)
+    {
+        memcpy(&values[0], p + 4, blob.count * sizeof(float));
+        return 0;
+    }
+
+    if (blob.storage == WeightBlob::FP16)
+    {
+        for (int i = 0; i < blob.count; i++)
+        {
+            unsigned short v;
+            memcpy(&v, p + 4 + i * sizeof(unsigned short), sizeof(unsigned short));
+            values[i] = ncnn::float16_to_float32(v);
+        }
+        return 0;
+    }
+
+    if (blob.storage == WeightBlob::QUANTIZED)
+    {
+        float table[256];
+        memcpy(table, p + 4, sizeof(table));
+
+        const unsigned char* index = p + 4 + sizeof(table);
+        for (int i = 0; i < blob.count; i++)
+        {
+            values[i] = table[index[i]];
+        }
+        return 0;
+    }
+
+    values.clear();
+    return -1;
+}
+
+void ModelRewriter::write_floats(int layer_index, int blob_index, const std::vector<float>& values)
+{
+    WeightBlob& blob = weights[layer_index][blob_index];
+
+    const size_t header = blob.storage == WeightBlob::RAW ? 0 : 4;
+
+    blob.count = (int)values.size();
+    if (blob.storage != WeightBlob::RAW)
+        blob.storage = WeightBlob::FP32;
+
+    // an all zero flag reads back as plain fp32
+    blob.data.assign(header + values.size() * sizeof(float), 0);
+    if (!values.empty())
+        memcpy(&blob.data[header], &values[0], values.size() * sizeof(float));
+    blob.size = blob.data.size();
+}
+
+std::string ModelRewriter::param_text() const
+{
+    std::set<std::string> blobs;
+    for (size_t i = 0; i < layers.size(); i++)
+    {
+        blobs.insert(layers[i].bottoms.begin(), layers[i].bottoms.end());
+        blobs.insert(layers[i].tops.begin(), layers[i].tops.end());
+    }
+
+    std::string text = "7767517\n";
+
+    char line[64];
+    sprintf(line, "%d %d\n", (int)layers.size(), (int)blobs.size());
+    text += line;
+
+    for (size_t i = 0; i < layers.size(); i++)
+    {
+        const ParamLayer& layer = layers[i];
+
+        sprintf(line, " %d %d", (int)layer.bottoms.size(), (int)layer.tops.size());
+        text += layer.type + " " + layer.name + line;
+
+        for (size_t j = 0; j < layer.bottoms.size(); j++)
+        {
+            text += " " + layer.bottoms[j];
+        }
+        for (size_t j = 0; j < layer.tops.size(); j++)
+        {
+            text += " " + layer.tops[j];
+        }
+        for (size_t j = 0; j < layer.values.size(); j++)
+        {
+            sprintf(line, " %d=", layer.values[j].first);
+            text += line + layer.values[j].second;
+        }
+
+        text += "\n";
+    }
+
+    return text;
+}
+
+int ModelRewriter::load_param(ncnn::Net& net) const
+{
+    std::string text = param_text();
+    return net.load_param_mem(text.c_str());
+}
+
+int ModelRewriter::find_head(int reg_max, std::vector<HeadLevel>& levels, int& num_class) const
+{
+    levels.clear();
+    num_class = -1;
+
+    for (size_t i = 0; i < layers.size(); i++)
+    {
+        const ParamLayer& reshape = layers[i];
+        if (reshape.type != "Reshape" || reshape.bottoms.size() != 1)
+            continue;
+
+        const int concat = find_layer_writing(reshape.bottoms[0]);
+        if (concat == -1 || layers[concat].type != "Concat" || layers[concat].bottoms.size() != 2 || layers[concat].get_int(0, 0) != 0)
+            continue;
+
+        const int box = find_layer_writing(layers[concat].bottoms[0]);
+        const int conv = find_layer_writing(layers[concat].bottoms[1]);
+        if (box == -1 || layers[box].type != "Convolution" || layers[box].get_int(0, 0) != reg_max * 4)
+            continue;
+        if (conv == -1 || layers[conv].type != "Convolution" || find_layer_reading(layers[concat].bottoms[1]) != concat)
+            continue;
+
+        const int num_output = layers[conv].get_int(0, 0);
+        if (reshape.get_int(1, 0) != reg_max * 4 + num_output)
+            continue;
+
+        if (num_class != -1 && num_output != num_class)
+            return -1;
+
+        num_class = num_output;
+
+        HeadLevel level;
+        level.reshape = (int)i;
+        level.concat = concat;
+        level.box = box;
+        level.conv = conv;
+        levels.push_back(level);
+    }
+
+    return levels.empty() ? -1 : 0;
+}
+
+int ModelRewriter::prune_classes(int reg_max, const std::vector<int>& classes)
+{
+    std::vector<HeadLevel> levels;
+    int num_class = 0;
+    if (find_head(reg_max, levels, num_class) != 0 || classes.empty())
+        return -1;
+
+    std::vector<bool> seen(num_class, false);
+    for (size_t i = 0; i < classes.size(); i++)
+    {
+        if (classes[i] < 0 || classes[i] >= num_class || seen[classes[i]])
+            return -1;
+
+        seen[classes[i]] = true;
+    }
+
+    const int keep = (int)classes.size();
+
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+        const int conv_index = levels[i].conv;
+
+        ParamLayer& conv = layers[conv_index];
+        if (conv.get_int(19, 0) || weights[conv_index].empty())
+            return -1;
+
+        const int weight_data_size = conv.get_int(6, 0);
+        const int bias_term = conv.get_int(5, 0);
+        const int int8_scale_term = conv.get_int(8, 0);
+        const int weight_per_output = weight_data_size / num_class;
+
+        // weights, bias and int8 weight scales are per output channel, the input and output scales are not
+        select_rows(conv_index, 0, weight_per_output, classes);
+        if (bias_term)
+            select_rows(conv_index, 1, 1, classes);
+        if (int8_scale_term)
+            select_rows(conv_index, 1 + bias_term, 1, classes);
+
+        conv.set_int(0, keep);
+        conv.set_int(6, keep * weight_per_output);
+
+        layers[levels[i].reshape].set_int(1, reg_max * 4 + keep);
+    }
+
+    return 0;
+}
+
+int ModelRewriter::split_head(int reg_max, const char* boxes, const char* scores)
+{
+    std::vector<HeadLevel> levels;
+    int num_class = 0;
+    if (find_head(reg_max, levels, num_class) != 0)
+        return -1;
+
+    // every level goes reshape, permute, into one concat along the anchors
+    std::vector<int> permutes(levels.size());
+    int out = -1;
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+        const HeadLevel& level = levels[i];
+        if (find_layer_reading(layers[level.concat].tops[0]) != level.reshape)
+            return -1;
+
+        const int permute = find_layer_reading(layers[level.reshape].tops[0]);
+        if (permute == -1 || layers[permute].type != "Permute" || layers[permute].get_int(0, 0) != 1)
+            return -1;
+
+        const int concat = find_layer_reading(layers[permute].tops[0]);
+        if (concat == -1 || layers[concat].type != "Concat" || layers[concat].get_int(0, 0) != 0 || (out != -1 && concat != out))
+            return -1;
+
+        if (find_layer_reading(layers[level.concat].bottoms[0]) != level.concat)
+            return -1;
+
+        permutes[i] = permute;
+        out = concat;
+    }
+
+    if (layers[out].bottoms.size() != levels.size())
+        return -1;
+
+    // the anchor order is the order the levels go into the output concat
+    std::vector<HeadLevel> ordered;
+    for (size_t i = 0; i < layers[out].bottoms.size(); i++)
+    {
+        for (size_t j = 0; j < levels.size(); j++)
+        {
+            if (layers[permutes[j]].tops[0] == layers[out].bottoms[i])
+                ordered.push_back(levels[j]);
+        }
+    }
+
+    if (ordered.size() != levels.size())
+        return -1;
+
+    std::vector<int> removed;
+    removed.push_back(out);
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+        removed.push_back(levels[i].concat);
+        removed.push_back(levels[i].reshape);
+        removed.push_back(permutes[i]);
+    }
+
+    std::vector<std::string> box_blobs;
+    std::vector<std::string> class_blobs;
+    for (size_t i = 0; i < ordered.size(); i++)
+    {
+        box_blobs.push_back(layers[ordered[i].concat].bottoms[0]);
+        class_blobs.push_back(layers[ordered[i].concat].bottoms[1]);
+    }
+
+    std::sort(removed.begin(), removed.end());
+    for (int i = (int)removed.size() - 1; i >= 0; i--)
+    {
+        layers.erase(layers.begin() + removed[i]);
+        weights.erase(weights.begin() + removed[i]);
+    }
+
+    ParamLayer box_concat;
+    box_concat.type = "Concat";
+    box_concat.name = std::string(boxes) + "_concat";
+    box_concat.tops.push_back(boxes);
+    box_concat.set_int(0, 0);
+
+    ParamLayer class_concat;
+    class_concat.type = "Concat";
+    class_concat.name = std::string(scores) + "_concat";
+    class_concat.tops.push_back(scores);
+    class_concat.set_int(0, 1);
+
+    char index[16];
+    for (size_t i = 0; i < ordered.size(); i++)
+    {
+        sprintf(index, "_%d", (int)i);
+
+        // anchor-major rows of reg_max * 4 box bins
+        ParamLayer box_reshape;
+        box_reshape.type = "Reshape";
+        box_reshape.name = std::string(boxes) + "_reshape" + index;
+        box_reshape.bottoms.push_back(box_blobs[i]);
+        box_reshape.tops.push_back(box_reshape.name);
+        box_reshape.set_int(0, -1);
+        box_reshape.set_int(1, reg_max * 4);
+        append_layer(box_reshape);
+
+        ParamLayer box_permute;
+        box_permute.type = "Permute";
+        box_permute.name = std::string(boxes) + "_permute" + index;
+        box_permute.bottoms.push_back(box_reshape.name);
+        box_permute.tops.push_back(box_permute.name);
+        box_permute.set_int(0, 1);
+        append_layer(box_permute);
+
+        box_concat.bottoms.push_back(box_permute.name);
+
+        // one row of anchors per class, concatenated along the anchors
+        ParamLayer class_reshape;
+        class_reshape.type = "Reshape";
+        class_reshape.name = std::string(scores) + "_reshape" + index;
+        class_reshape.bottoms.push_back(class_blobs[i]);
+        class_reshape.tops.push_back(class_reshape.name);
+        class_reshape.set_int(0, -1);
+        class_reshape.set_int(1, num_class);
+        append_layer(class_reshape);
+
+        class_concat.bottoms.push_back(class_reshape.name);
+    }
+
+    append_layer(box_concat);
+    append_layer(class_concat);
+
+    return 0;
+}
+
+void ModelRewriter::select_rows(int layer_index, int blob_index, int row_size, const std::vector<int>& rows)
+{
+    WeightBlob& blob = weights[layer_index][blob_index];
+
+    if (blob.storage == WeightBlob::INT8)
+    {
+        // int8 has no fp32 form, copy the bytes and keep the flag
+        const unsigned char* p = blob.data.empty() ? bin + blob.offset : &blob.data[0];
+
+        std::vector<unsigned char> data(4 + align_size(rows.size() * row_size, 4), 0);
+        memcpy(&data[0], p, 4);
+        for (size_t i = 0; i < rows.size(); i++)
+        {
+            memcpy(&data[4 + i * row_size], p + 4 + (size_t)rows[i] * row_size, row_size);
+        }
+
+        blob.data.swap(data);
+        blob.count = (int)rows.size() * row_size;
+        blob.size = blob.data.size();
+        return;
+    }
+
+    std::vector<float> values;
+    read_floats(layer_index, blob_index, values);
+
+    std::vector<float> selected(rows.size() * row_size);
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        memcpy(&selected[i * row_size], &values[(size_t)rows[i] * row_size], row_size * sizeof(float));
+    }
+
+    write_floats(layer_index, blob_index, selected);
+}
+
+void ModelRewriter::append_layer(const ParamLayer& layer)
+{
+    layers.push_back(layer);
+    weights.push_back(std::vector<WeightBlob>());
+}
+
+void ModelRewriter::expand_weights()
+{
+    for (size_t i = 0; i < weights.size(); i++)
+    {
+        for (size_t j = 0; j < weights[i].size(); j++)
+        {
+            const int storage = weights[i][j].storage;
+            if (storage != WeightBlob::FP16 && storage != WeightBlob::QUANTIZED)
+                continue;
+
+            std::vector<float> values;
+            read_floats((int)i, (int)j, values);
+            write_floats((int)i, (int)j, values);
+        }
+    }
+}
+
+void ModelRewriter::get_segments(std::vector<std::pair<const unsigned char*, size_t> >& segments) const
+{
+    segments.clear();
+    for (size_t i = 0; i < weights.size(); i++)
+    {
+        for (size_t j = 0; j < weights[i].size(); j++)
+        {
+            const WeightBlob& blob = weights[i][j];
+            if (blob.data.empty())
+                segments.push_back(std::make_pair(bin + blob.offset, blob.size));
+            else
+                segments.push_back(std::make_pair(&blob.data[0], blob.data.size()));
+        }
+    }
+}
+
+int ModelRewriter::load_model(ncnn::Net& net) const
+{
+    std::vector<std::pair<const unsigned char*, size_t> > segments;
+    get_segments(segments);
+
+    RewriteDataReader dr(segments);
+    return net.load_model(dr);
+}
+
+int ModelRewriter::save(const char* parampath, const char* binpath) const
+{
+    std::string text = param_text();
+
+    FILE* fp = fopen(parampath, "wb");
+    if (!fp)
+        return -1;
+
+    size_t nwrite = fwrite(text.data(), 1, text.size(), fp);
+    fclose(fp);
+
+    if (nwrite != text.size())
+        return -1;
+
+    fp = fopen(binpath, "wb");
+    if (!fp)
+        return -1;
+
+    std::vector<std::pair<const unsigned char*, size_t> > segments;
+    get_segments(segments);
+
+    int ret = 0;
+    for (size_t i = 0; i < segments.size(); i++)
+    {
+        if (fwrite(segments[i].first, 1, segments[i].second, fp) != segments[i].second)
+        {
+            ret = -1;
+            break;
+        }
+    }
+
+    if (fclose(fp) != 0)
+        ret = -1;
+
+    return ret;
+}
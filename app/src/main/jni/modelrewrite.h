@@ -0,0 +1,133 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2025 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef MODELREWRITE_H
+#define MODELREWRITE_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <net.h>
+
+// one layer line of a text param file
+// values stay text so whatever is not rewritten goes back to ncnn exactly as it was read
+struct ParamLayer
+{
+    std::string type;
+    std::string name;
+    std::vector<std::string> bottoms;
+    std::vector<std::string> tops;
+    std::vector<std::pair<int, std::string> > values; // id=value in file order, arrays keep their -23300-id form
+
+    int get_int(int id, int default_value) const;
+    float get_float(int id, float default_value) const;
+    void set_int(int id, int value);
+};
+
+// one ModelBin load of a layer, in load order
+struct WeightBlob
+{
+    enum
+    {
+        RAW = 0,      // fp32 without storage flag, bias and int8 scales
+        FP32 = 1,
+        FP16 = 2,
+        INT8 = 3,
+        QUANTIZED = 4 // 256 entry fp32 table and uint8 indices
+    };
+
+    size_t offset; // from the start of the bin
+    size_t size;   // bytes including the storage flag
+    int count;     // number of values
+    int storage;
+
+    // replacement bytes in the same storage layout, empty keeps the original
+    std::vector<unsigned char> data;
+};
+
+// load-time graph surgery on a param and bin pair
+// weights that are not rewritten are referenced in place, the bin must outlive the rewriter
+// and the rewriter must outlive the net loaded from it, ncnn keeps pointers to fp32 blobs
+class ModelRewriter
+{
+public:
+    ModelRewriter() : bin(0), bin_size(0) {}
+
+    // fails on anything it cannot account for byte by byte, the caller then loads the model as is
+    int parse(const char* param, const unsigned char* bin, size_t bin_size);
+    // layers only, for inspecting the graph without weights
+    int parse_param(const char* param);
+
+    // blobs where the spatially local front of the graph, convolutions and elementwise layers,
+    // hands over to the first layer that mixes positions globally such as attention, reshape or upsample
+    // a feature at these blobs depends only on a neighbourhood of the input, reaching radii input pixels from it
+    int find_local_cut(std::vector<std::string>& blobs, std::vector<int>& radii) const;
+
+    // scale the net input by folding the factor into the weights of the one convolution reading it
+    // fp32 and fp16 weights are scaled, int8 keeps its weights and moves the factor into the quantize scales
+    int fold_input_scale(float scale);
+
+    // keep only the given output channels of the class convolutions of a yolo head, in the given order
+    // every level concats a box convolution of reg_max * 4 channels with a class convolution and reshapes
+    // the pair to reg_max * 4 + num_class rows, all levels must agree on num_class
+    int prune_classes(int reg_max, const std::vector<int>& classes);
+
+    // replace the anchor-major head output of reg_max * 4 box bins and num_class scores per row with two blobs
+    // boxes keeps the anchor-major rows of box bins, scores is a class-major plane of w=anchors h=num_class
+    int split_head(int reg_max, const char* boxes, const char* scores);
+
+    // new weightless layer at the end of the graph
+    void append_layer(const ParamLayer& layer);
+
+    // decode fp16 and quantized weights to fp32, ncnn then references every weight in place
+    void expand_weights();
+
+    int load_param(ncnn::Net& net) const;
+    int load_model(ncnn::Net& net) const;
+
+    // write the rewritten param and bin pair, loadable by any ncnn
+    int save(const char* parampath, const char* binpath) const;
+
+    std::string param_text() const;
+
+    // fp32, fp16 and quantized blobs decode to fp32, int8 has no fp32 form and fails
+    int read_floats(int layer_index, int blob_index, std::vector<float>& values) const;
+    // replace the blob with fp32 values, with a storage flag unless the blob is RAW
+    void write_floats(int layer_index, int blob_index, const std::vector<float>& values);
+
+    std::vector<ParamLayer> layers;
+    std::vector<std::vector<WeightBlob> > weights; // per layer
+
+private:
+    // the box and class convolutions of one head level and the layers joining them
+    struct HeadLevel
+    {
+        int reshape;
+        int concat;
+        int box;
+        int conv;
+    };
+
+    int find_head(int reg_max, std::vector<HeadLevel>& levels, int& num_class) const;
+    int find_layer_reading(const std::string& blob) const;
+    int find_layer_writing(const std::string& blob) const;
+    void select_rows(int layer_index, int blob_index, int row_size, const std::vector<int>& rows);
+    void get_segments(std::vector<std::pair<const unsigned char*, size_t> >& segments) const;
+
+    const unsigned char* bin;
+    size_t bin_size;
+};
+
+#endif // MODELREWRITE_H
@@ -0,0 +1,173 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2025 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "sizecontroller.h"
+
+#include <android/log.h>
+
+#include <algorithm>
+
+#include <benchmark.h>
+
+// the network accepts any multiple of its max stride
+static const int size_step = 32;
+
+// weight of the newest frame in the smoothed latency
+static const float latency_alpha = 0.2f;
+
+// grow only if the next size up, roughly (s+32)^2/s^2 slower, would still fit
+static const float grow_ratio = 0.7f;
+
+// frames over / under budget before stepping
+static const int slow_frames_to_shrink = 5;
+static const int fast_frames_to_grow = 60;
+
+// frames ignored after a step, the first ones at a new size run on cold pools
+static const int settle_frames_after_step = 10;
+
+static const int max_history = 32;
+
+static int clamp_size(int size, int min_size, int max_size)
+{
+    return std::min(std::max(size, min_size), max_size);
+}
+
+SizeController::SizeController()
+{
+    budget = 0.f;
+    min_size = 160;
+    max_size = 640;
+    base_size = 320;
+    size = 320;
+
+    latency_avg = 0.f;
+    slow_frames = 0;
+    fast_frames = 0;
+    settle_frames = 0;
+}
+
+void SizeController::set_budget(float budget_ms)
+{
+    ncnn::MutexLockGuard g(lock);
+
+    budget = std::max(budget_ms, 0.f);
+
+    if (budget == 0.f)
+        size = base_size;
+}
+
+float SizeController::get_budget() const
+{
+    ncnn::MutexLockGuard g(lock);
+
+    return budget;
+}
+
+void SizeController::set_bounds(int _min_size, int _max_size)
+{
+    ncnn::MutexLockGuard g(lock);
+
+    min_size = std::max(_min_size / size_step, 1) * size_step;
+    max_size = std::max(_max_size / size_step * size_step, min_size);
+
+    if (budget > 0.f)
+        size = clamp_size(size, min_size, max_size);
+}
+
+void SizeController::reset(int _size)
+{
+    ncnn::MutexLockGuard g(lock);
+
+    base_size = _size;
+    size = clamp_size(_size, min_size, max_size);
+    latency_avg = 0.f;
+    slow_frames = 0;
+    fast_frames = 0;
+    settle_frames = settle_frames_after_step;
+}
+
+int SizeController::update(float latency_ms)
+{
+    ncnn::MutexLockGuard g(lock);
+
+    if (budget <= 0.f)
+        return size;
+
+    if (settle_frames > 0)
+    {
+        settle_frames--;
+        return size;
+    }
+
+    latency_avg = latency_avg == 0.f ? latency_ms : latency_avg + (latency_ms - latency_avg) * latency_alpha;
+
+    // the bounds may have moved since the last step
+    int new_size = clamp_size(size, min_size, max_size);
+
+    if (latency_avg > budget)
+    {
+        fast_frames = 0;
+        if (++slow_frames >= slow_frames_to_shrink && new_size > min_size)
+            new_size = clamp_size(new_size - size_step, min_size, max_size);
+    }
+    else if (latency_avg < budget * grow_ratio)
+    {
+        slow_frames = 0;
+        if (++fast_frames >= fast_frames_to_grow && new_size < max_size)
+            new_size = clamp_size(new_size + size_step, min_size, max_size);
+    }
+    else
+    {
+        // inside the hysteresis band
+        slow_frames = 0;
+        fast_frames = 0;
+    }
+
+    if (new_size != size)
+    {
+        Decision d;
+        d.time = ncnn::get_current_time();
+        d.from_size = size;
+        d.to_size = new_size;
+        d.latency = latency_avg;
+
+        history.push_back(d);
+        if ((int)history.size() > max_history)
+            history.pop_front();
+
+        __android_log_print(ANDROID_LOG_DEBUG, "ncnn", "det_target_size %d -> %d at %.2fms budget %.2fms", size, new_size, latency_avg, budget);
+
+        size = new_size;
+        latency_avg = 0.f;
+        slow_frames = 0;
+        fast_frames = 0;
+        settle_frames = settle_frames_after_step;
+    }
+
+    return size;
+}
+
+int SizeController::get_size() const
+{
+    ncnn::MutexLockGuard g(lock);
+
+    return size;
+}
+
+std::deque<SizeController::Decision> SizeController::get_history() const
+{
+    ncnn::MutexLockGuard g(lock);
+
+    return history;
+}
@@ -0,0 +1,71 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2025 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef SIZECONTROLLER_H
+#define SIZECONTROLLER_H
+
+#include <deque>
+
+#include <platform.h>
+
+// steps det_target_size in multiples of 32 to keep detect latency within a budget
+// shrinks after a run of slow frames, grows back only after a longer run of fast ones
+class SizeController
+{
+public:
+    SizeController();
+
+    struct Decision
+    {
+        double time;
+        int from_size;
+        int to_size;
+        float latency; // smoothed detect latency in ms that triggered it
+    };
+
+    // 0 disables the controller and goes back to the reset size
+    void set_budget(float budget_ms);
+    float get_budget() const;
+
+    void set_bounds(int min_size, int max_size);
+
+    // start over at the nominal size of a newly selected model
+    void reset(int size);
+
+    // feed the detect latency of the frame just run, returns the size for the next frame
+    int update(float latency_ms);
+
+    int get_size() const;
+
+    // oldest first, bounded to the most recent decisions
+    std::deque<Decision> get_history() const;
+
+private:
+    mutable ncnn::Mutex lock;
+
+    float budget;
+    int min_size;
+    int max_size;
+    int base_size;
+    int size;
+
+    float latency_avg;
+    int slow_frames;
+    int fast_frames;
+    int settle_frames;
+
+    std::deque<Decision> history;
+};
+
+#endif // SIZECONTROLLER_H
@@ -14,14 +14,98 @@
 
 #include "yolo11.h"
 
+#include "modelrewrite.h"
+#include "yolo11decode.h"
+
+#include <android/log.h>
+
+#include <algorithm>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <benchmark.h>
+#include <cpu.h>
+#include <datareader.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+FeatureCache::FeatureCache()
+{
+    change_threshold = 6.f;
+    max_coverage = 0.5f;
+    halo = 0;
+    parity_interval = 30;
+
+    frames = 0;
+    full_frames = 0;
+    incremental_frames = 0;
+    unchanged_frames = 0;
+    coverage_sum = 0.f;
+    parity_checks = 0;
+    parity_mismatches = 0;
+    parity_max_diff = 0.f;
+
+    owner = 0;
+    since_parity = 0;
+}
+
+void FeatureCache::reset()
+{
+    owner = 0;
+    last_in.release();
+    features.clear();
+    last_objects.clear();
+    since_parity = 0;
+}
+
+YOLO11::YOLO11()
+{
+    det_target_size = 320;
+
+    weights_mmap = true;
+    weights_prefetch = false;
+    weights_size = 0;
+    weights_mapped = 0;
+    weights_mapped_size = 0;
+    weights_asset = 0;
+
+    source_mem = 0;
+    source_size = 0;
+
+    fold_normalize = true;
+    normalize_folded = false;
+    rewriter = 0;
+    cache_mapped = 0;
+    cache_mapped_size = 0;
+
+    ready = true;
+    warm_latency = 0.f;
+}
+
 YOLO11::~YOLO11()
 {
+    // the net may reference the mapped weights, drop it before unmapping
+    yolo11.clear();
+    release_weights();
+
+    for (size_t i = 0; i < contexts.size(); i++)
+    {
+        delete contexts[i];
+    }
+    contexts.clear();
+    free_contexts.clear();
+
     det_target_size = 320;
 }
 
 int YOLO11::load(const char* parampath, const char* modelpath, bool use_gpu)
 {
     yolo11.clear();
+    release_weights();
 
     yolo11.opt = ncnn::Option();
 
@@ -29,8 +113,29 @@ int YOLO11::load(const char* parampath, const char* modelpath, bool use_gpu)
     yolo11.opt.use_vulkan_compute = use_gpu;
 #endif
 
-    yolo11.load_param(parampath);
-    yolo11.load_model(modelpath);
+    // appended by rewrite_graph, and found in cached graphs
+    yolo11.register_custom_layer("YOLO11Decode", YOLO11Decode_layer_creator);
+
+    // the param text is kept, the graph may be rewritten against the weights
+    std::string param;
+    {
+        FILE* fp = fopen(parampath, "rb");
+        if (!fp)
+            return -1;
+
+        char buf[4096];
+        size_t nread;
+        while ((nread = fread(buf, 1, sizeof(buf), fp)) > 0)
+        {
+            param.append(buf, nread);
+        }
+        fclose(fp);
+    }
+
+    inspect_graph(param);
+
+    if (load_weights(param, modelpath) != 0)
+        return -1;
 
     return 0;
 }
@@ -38,6 +143,7 @@ int YOLO11::load(const char* parampath, const char* modelpath, bool use_gpu)
 int YOLO11::load(AAssetManager* mgr, const char* parampath, const char* modelpath, bool use_gpu)
 {
     yolo11.clear();
+    release_weights();
 
     yolo11.opt = ncnn::Option();
 
@@ -45,8 +151,22 @@ int YOLO11::load(AAssetManager* mgr, const char* parampath, const char* modelpat
     yolo11.opt.use_vulkan_compute = use_gpu;
 #endif
 
-    yolo11.load_param(mgr, parampath);
-    yolo11.load_model(mgr, modelpath);
+    yolo11.register_custom_layer("YOLO11Decode", YOLO11Decode_layer_creator);
+
+    std::string param;
+    {
+        AAsset* asset = AAssetManager_open(mgr, parampath, AASSET_MODE_BUFFER);
+        if (!asset)
+            return -1;
+
+        param.assign((const char*)AAsset_getBuffer(asset), AAsset_getLength(asset));
+        AAsset_close(asset);
+    }
+
+    inspect_graph(param);
+
+    if (load_weights(param, mgr, modelpath) != 0)
+        return -1;
 
     return 0;
 }
@@ -55,3 +175,720 @@ void YOLO11::set_det_target_size(int target_size)
 {
     det_target_size = target_size;
 }
+
+int YOLO11::get_det_target_size() const
+{
+    return det_target_size;
+}
+
+void YOLO11::set_weights_mmap(bool enable, bool prefetch)
+{
+    weights_mmap = enable;
+    weights_prefetch = prefetch;
+}
+
+size_t YOLO11::get_weights_size() const
+{
+    return weights_size;
+}
+
+void YOLO11::set_fold_normalize(bool enable)
+{
+    fold_normalize = enable;
+}
+
+bool YOLO11::is_normalize_folded() const
+{
+    return normalize_folded;
+}
+
+void YOLO11::set_rewrite_cache(const std::string& dir)
+{
+    rewrite_cache_dir = dir;
+}
+
+void YOLO11::set_class_subset(const std::vector<int>& classes)
+{
+    class_subset = classes;
+}
+
+const std::vector<int>& YOLO11::get_class_subset() const
+{
+    return class_subset;
+}
+
+bool YOLO11::is_class_subset_applied() const
+{
+    return !class_map.empty();
+}
+
+int YOLO11::reload()
+{
+    if (!source_mem)
+        return -1;
+
+    // options and custom layers survive clear
+    yolo11.clear();
+    release_rewritten();
+
+    weights_size = source_size;
+
+    return load_mapped(source_param, source_mem, source_size);
+}
+
+void YOLO11::rewrite_graph(ModelRewriter& rw)
+{
+    if (class_subset.empty())
+        return;
+
+    // ultralytics heads use 16 dfl bins
+    if (rw.prune_classes(16, class_subset) == 0)
+    {
+        class_map = class_subset;
+    }
+    else
+    {
+        __android_log_print(ANDROID_LOG_WARN, "ncnn", "class subset not applied, no matching class head");
+    }
+}
+
+int YOLO11::graph_variant() const
+{
+    return 0;
+}
+
+void YOLO11::remap_labels(std::vector<Object>& objects) const
+{
+    if (class_map.empty())
+        return;
+
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+        objects[i].label = class_map[objects[i].label];
+    }
+}
+
+int YOLO11::get_decode_threads(const YOLO11Context& ctx) const
+{
+    return std::max(ctx.num_threads > 0 ? ctx.num_threads : yolo11.opt.num_threads, 1);
+}
+
+bool YOLO11::has_output(const char* name) const
+{
+    const std::vector<const char*>& names = yolo11.output_names();
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        if (strcmp(names[i], name) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+void YOLO11::inspect_graph(const std::string& param)
+{
+    // blob names survive every rewrite, the original text is enough
+    ModelRewriter graph;
+    if (graph.parse_param(param.c_str()) != 0 || graph.find_local_cut(local_cut_blobs, local_cut_radii) != 0)
+    {
+        local_cut_blobs.clear();
+        local_cut_radii.clear();
+    }
+}
+
+int YOLO11::load_weights(const std::string& param, const char* modelpath)
+{
+    int fd = open(modelpath, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    weights_size = st.st_size;
+
+    if (!weights_mmap)
+    {
+        close(fd);
+
+        if (yolo11.load_param_mem(param.c_str()) != 0)
+            return -1;
+
+        return yolo11.load_model(modelpath);
+    }
+
+    void* ptr = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (ptr == MAP_FAILED)
+        return -1;
+
+    weights_mapped = ptr;
+    weights_mapped_size = st.st_size;
+
+    if (weights_prefetch)
+    {
+        madvise(weights_mapped, weights_mapped_size, MADV_WILLNEED);
+    }
+
+    source_param = param;
+    source_mem = (const unsigned char*)weights_mapped;
+    source_size = weights_mapped_size;
+
+    return load_mapped(param, (const unsigned char*)weights_mapped, weights_mapped_size);
+}
+
+int YOLO11::load_weights(const std::string& param, AAssetManager* mgr, const char* modelpath)
+{
+    if (weights_mmap)
+    {
+        // uncompressed assets come back as a read-only mapping of the apk
+        weights_asset = AAssetManager_open(mgr, modelpath, AASSET_MODE_BUFFER);
+        if (!weights_asset)
+            return -1;
+
+        weights_size = AAsset_getLength(weights_asset);
+
+        const void* buffer = AAsset_getBuffer(weights_asset);
+        if (buffer)
+        {
+            if (weights_prefetch && !AAsset_isAllocated(weights_asset))
+            {
+                // madvise wants a page aligned start
+                const size_t pagesize = sysconf(_SC_PAGESIZE);
+                const size_t offset = (size_t)buffer % pagesize;
+                madvise((void*)((const unsigned char*)buffer - offset), AAsset_getLength(weights_asset) + offset, MADV_WILLNEED);
+            }
+
+            source_param = param;
+            source_mem = (const unsigned char*)buffer;
+            source_size = weights_size;
+
+            return load_mapped(param, (const unsigned char*)buffer, weights_size);
+        }
+
+        // a compressed bin has no buffer, load it like an unmapped model
+        __android_log_print(ANDROID_LOG_WARN, "ncnn", "%s not mappable, check noCompress, streamed instead", modelpath);
+
+        AAsset_close(weights_asset);
+        weights_asset = 0;
+    }
+
+    AAsset* asset = AAssetManager_open(mgr, modelpath, AASSET_MODE_STREAMING);
+    if (!asset)
+        return -1;
+
+    weights_size = AAsset_getLength(asset);
+
+    if (yolo11.load_param_mem(param.c_str()) != 0)
+    {
+        AAsset_close(asset);
+        return -1;
+    }
+
+    int ret = yolo11.load_model(asset);
+    AAsset_close(asset);
+    return ret;
+}
+
+int YOLO11::load_mapped(const std::string& param, const unsigned char* mem, size_t size)
+{
+    std::string cache_path;
+    if (!rewrite_cache_dir.empty())
+    {
+        cache_path = rewrite_cache_dir + "/" + rewrite_cache_key(param, mem, size);
+
+        if (load_cached(cache_path) == 0)
+            return 0;
+    }
+
+    ModelRewriter* rw = new ModelRewriter;
+    if (rw->parse(param.c_str(), mem, size) != 0)
+    {
+        delete rw;
+        rw = 0;
+    }
+
+    bool folded = false;
+    if (rw && fold_normalize)
+    {
+        folded = rw->fold_input_scale(1 / 255.f) == 0;
+    }
+
+    if (rw)
+    {
+        rewrite_graph(*rw);
+    }
+
+    if (!class_subset.empty() && !rw)
+    {
+        __android_log_print(ANDROID_LOG_WARN, "ncnn", "class subset not applied, weights not rewritable");
+    }
+
+    if (fold_normalize && !folded)
+    {
+        __android_log_print(ANDROID_LOG_WARN, "ncnn", "input normalization not folded, first layer is not a plain convolution");
+    }
+
+    if (rw && !cache_path.empty())
+    {
+        rw->expand_weights();
+
+        // the meta file goes last, an entry without it was cut short and is rewritten
+        int ret = rw->save((cache_path + ".param").c_str(), (cache_path + ".bin").c_str());
+        if (ret == 0)
+        {
+            FILE* fp = fopen((cache_path + ".meta.tmp").c_str(), "wb");
+            if (fp)
+            {
+                fprintf(fp, "folded %d\npruned %d\n", folded ? 1 : 0, class_map.empty() ? 0 : 1);
+                ret = fclose(fp);
+            }
+            else
+            {
+                ret = -1;
+            }
+        }
+        if (ret == 0)
+        {
+            ret = rename((cache_path + ".meta.tmp").c_str(), (cache_path + ".meta").c_str());
+        }
+
+        // a cache file that cannot be mapped back still leaves the rewritten graph in rw
+        if (ret == 0 && load_cached(cache_path) == 0)
+        {
+            delete rw;
+            return 0;
+        }
+
+        __android_log_print(ANDROID_LOG_WARN, "ncnn", "rewrite cache %s not %s, loading from memory", cache_path.c_str(), ret == 0 ? "loaded" : "written");
+    }
+
+    if (rw)
+    {
+        rewriter = rw;
+        normalize_folded = folded;
+
+        if (rw->load_param(yolo11) != 0)
+            return -1;
+
+        return rw->load_model(yolo11);
+    }
+
+    if (yolo11.load_param_mem(param.c_str()) != 0)
+        return -1;
+
+    // fp32 weights are referenced in place, the others are converted into the heap as before
+    ncnn::DataReaderFromMemory dr(mem);
+    return yolo11.load_model(dr);
+}
+
+static uint64_t fnv1a(uint64_t hash, const void* data, size_t size)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= p[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+std::string YOLO11::rewrite_cache_key(const std::string& param, const unsigned char* mem, size_t size) const
+{
+    // bump when the cached layout changes
+    const int version = 3;
+
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    hash = fnv1a(hash, &version, sizeof(version));
+    hash = fnv1a(hash, param.data(), param.size());
+    hash = fnv1a(hash, &size, sizeof(size));
+
+    // hashing every byte would cost as much as the conversion it saves, sample a page per megabyte
+    const size_t page = 4096;
+    for (size_t offset = 0; offset < size; offset += 1024 * 1024)
+    {
+        hash = fnv1a(hash, mem + offset, std::min(page, size - offset));
+    }
+    if (size > page)
+    {
+        hash = fnv1a(hash, mem + size - page, page);
+    }
+
+    const ncnn::Option& opt = yolo11.opt;
+    const int options[] = {
+        opt.use_vulkan_compute,
+        opt.use_int8_inference,
+        opt.use_fp16_packed,
+        opt.use_fp16_storage,
+        opt.use_fp16_arithmetic,
+        opt.use_bf16_storage,
+        opt.use_packing_layout,
+        opt.use_winograd_convolution,
+        opt.use_sgemm_convolution,
+        fold_normalize,
+        graph_variant()
+    };
+    hash = fnv1a(hash, options, sizeof(options));
+
+    if (!class_subset.empty())
+    {
+        hash = fnv1a(hash, &class_subset[0], class_subset.size() * sizeof(int));
+    }
+
+    char key[32];
+    sprintf(key, "%016llx", (unsigned long long)hash);
+    return key;
+}
+
+int YOLO11::load_cached(const std::string& path)
+{
+    int folded = 0;
+    int pruned = 0;
+    {
+        FILE* fp = fopen((path + ".meta").c_str(), "rb");
+        if (!fp)
+            return -1;
+
+        int nscan = fscanf(fp, "folded %d pruned %d", &folded, &pruned);
+        fclose(fp);
+
+        if (nscan != 2)
+            return -1;
+    }
+
+    int fd = open((path + ".bin").c_str(), O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    void* ptr = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (ptr == MAP_FAILED)
+        return -1;
+
+    if (weights_prefetch)
+    {
+        madvise(ptr, st.st_size, MADV_WILLNEED);
+    }
+
+    // every fp32 weight is referenced in place from the cache file
+    const unsigned char* mem = (const unsigned char*)ptr;
+    ncnn::DataReaderFromMemory dr(mem);
+    if (yolo11.load_param((path + ".param").c_str()) != 0 || yolo11.load_model(dr) != 0)
+    {
+        yolo11.clear();
+        munmap(ptr, st.st_size);
+        return -1;
+    }
+
+    // the original weights stay mapped for reload, untouched pages drop out of memory
+    release_rewritten();
+
+    weights_size = st.st_size;
+    cache_mapped = ptr;
+    cache_mapped_size = st.st_size;
+    normalize_folded = folded != 0;
+    if (pruned)
+        class_map = class_subset;
+
+    return 0;
+}
+
+void YOLO11::release_rewritten()
+{
+    normalize_folded = false;
+    class_map.clear();
+    delete rewriter;
+    rewriter = 0;
+
+    if (cache_mapped)
+    {
+        munmap(cache_mapped, cache_mapped_size);
+        cache_mapped = 0;
+        cache_mapped_size = 0;
+    }
+}
+
+void YOLO11::release_weights()
+{
+    release_rewritten();
+
+    weights_size = 0;
+
+    source_param.clear();
+    source_mem = 0;
+    source_size = 0;
+
+    if (weights_mapped)
+    {
+        munmap(weights_mapped, weights_mapped_size);
+        weights_mapped = 0;
+        weights_mapped_size = 0;
+    }
+
+    if (weights_asset)
+    {
+        AAsset_close(weights_asset);
+        weights_asset = 0;
+    }
+}
+
+int YOLO11::detect(const cv::Mat& rgb, std::vector<Object>& objects)
+{
+    YOLO11Context* ctx = acquire_context();
+
+    int ret = detect(rgb, objects, *ctx);
+
+    release_context(ctx);
+
+    return ret;
+}
+
+int YOLO11::detect(const cv::Mat& rgb, std::vector<Object>& objects, YOLO11Context& ctx)
+{
+    int target_size = 0;
+    bool square = false;
+    get_letterbox_size(target_size, square);
+
+    Letterbox lb;
+    letterbox(rgb, target_size, square, !normalize_folded, lb, ctx);
+
+    return detect(lb, objects, ctx);
+}
+
+void YOLO11::get_letterbox_size(int& target_size, bool& square) const
+{
+    target_size = det_target_size;
+    square = false;
+}
+
+void YOLO11::letterbox(const cv::Mat& rgb, int target_size, bool square, bool normalize, Letterbox& lb, YOLO11Context& ctx)
+{
+    const int max_stride = 32;
+
+    int img_w = rgb.cols;
+    int img_h = rgb.rows;
+
+    // letterbox pad to multiple of max_stride
+    int w = img_w;
+    int h = img_h;
+    float scale = 1.f;
+    if (w > h)
+    {
+        scale = (float)target_size / w;
+        w = target_size;
+        h = h * scale;
+    }
+    else
+    {
+        scale = (float)target_size / h;
+        h = target_size;
+        w = w * scale;
+    }
+
+    // pre-processing Mats come from the same pools as the net blobs
+    ncnn::Option pool_opt;
+    pool_opt.blob_allocator = &ctx.blob_allocator;
+    pool_opt.workspace_allocator = &ctx.workspace_allocator;
+    if (ctx.num_threads > 0)
+        pool_opt.num_threads = ctx.num_threads;
+
+    // rgb may be a roi of a larger frame, pass its row stride
+    ncnn::Mat in = ncnn::Mat::from_pixels_resize(rgb.data, ncnn::Mat::PIXEL_RGB, img_w, img_h, (int)rgb.step, w, h, &ctx.blob_allocator);
+
+    // letterbox pad to target_size rectangle
+    int wpad = (w + max_stride - 1) / max_stride * max_stride - w;
+    int hpad = (h + max_stride - 1) / max_stride * max_stride - h;
+    if (square)
+    {
+        wpad = target_size - w;
+        hpad = target_size - h;
+    }
+    ncnn::copy_make_border(in, lb.in_pad, hpad / 2, hpad - hpad / 2, wpad / 2, wpad - wpad / 2, ncnn::BORDER_CONSTANT, 114.f, pool_opt);
+
+    if (normalize)
+    {
+        const float norm_vals[3] = {1 / 255.f, 1 / 255.f, 1 / 255.f};
+        lb.in_pad.substract_mean_normalize(0, norm_vals);
+    }
+
+    lb.img_w = img_w;
+    lb.img_h = img_h;
+    lb.scale = scale;
+    lb.wpad = wpad;
+    lb.hpad = hpad;
+}
+
+YOLO11Context* YOLO11::acquire_context()
+{
+    ncnn::MutexLockGuard g(context_lock);
+
+    if (free_contexts.empty())
+    {
+        YOLO11Context* ctx = new YOLO11Context;
+        contexts.push_back(ctx);
+        return ctx;
+    }
+
+    YOLO11Context* ctx = free_contexts.back();
+    free_contexts.pop_back();
+    return ctx;
+}
+
+void YOLO11::release_context(YOLO11Context* ctx)
+{
+    ctx->num_threads = 0;
+    ctx->prob_threshold = 0.f;
+
+    ncnn::MutexLockGuard g(context_lock);
+
+    free_contexts.push_back(ctx);
+}
+
+int YOLO11::detect_batch(const std::vector<cv::Mat>& rgbs, std::vector<std::vector<Object> >& objects, int num_threads)
+{
+    if (num_threads <= 0)
+        num_threads = yolo11.opt.num_threads;
+
+    num_threads = std::max(std::min(num_threads, (int)rgbs.size()), 1);
+
+    std::vector<YOLO11Context*> batch_contexts(num_threads);
+    for (int i = 0; i < num_threads; i++)
+    {
+        batch_contexts[i] = acquire_context();
+        batch_contexts[i]->num_threads = 1;
+    }
+
+    objects.clear();
+    objects.resize(rgbs.size());
+
+    // images are independent, one image per thread beats one image over all threads
+    #pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+    for (int i = 0; i < (int)rgbs.size(); i++)
+    {
+        YOLO11Context& ctx = *batch_contexts[ncnn::get_omp_thread_num()];
+
+        detect(rgbs[i], objects[i], ctx);
+    }
+
+    for (int i = 0; i < num_threads; i++)
+    {
+        release_context(batch_contexts[i]);
+    }
+
+    return 0;
+}
+
+void YOLO11::print_pool_stats() const
+{
+#if YOLO11_POOL_STATS
+    size_t blob_requests = 0;
+    size_t blob_hits = 0;
+    size_t blob_size = 0;
+    size_t workspace_requests = 0;
+    size_t workspace_hits = 0;
+    size_t workspace_size = 0;
+    size_t context_count = 0;
+
+    {
+        ncnn::MutexLockGuard g(context_lock);
+
+        context_count = contexts.size();
+        for (size_t i = 0; i < contexts.size(); i++)
+        {
+            size_t requests = 0;
+            size_t hits = 0;
+            size_t size = 0;
+
+            contexts[i]->blob_allocator.get_stats(requests, hits, size);
+            blob_requests += requests;
+            blob_hits += hits;
+            blob_size += size;
+
+            contexts[i]->workspace_allocator.get_stats(requests, hits, size);
+            workspace_requests += requests;
+            workspace_hits += hits;
+            workspace_size += size;
+        }
+    }
+
+    __android_log_print(ANDROID_LOG_DEBUG, "ncnn", "pool x%zu blob %zuKB hit %zu/%zu workspace %zuKB hit %zu/%zu",
+                        context_count, blob_size / 1024, blob_hits, blob_requests, workspace_size / 1024, workspace_hits, workspace_requests);
+#else
+    size_t context_count = 0;
+    {
+        ncnn::MutexLockGuard g(context_lock);
+
+        context_count = contexts.size();
+    }
+
+    __android_log_print(ANDROID_LOG_DEBUG, "ncnn", "pool x%zu, build with YOLO11NCNN_POOL_STATS for hit rates", context_count);
+#endif // YOLO11_POOL_STATS
+}
+
+int YOLO11::warmup(int loop_count)
+{
+    {
+        ncnn::MutexLockGuard g(warmup_lock);
+        ready = loop_count <= 0;
+        warm_latency = 0.f;
+    }
+
+    if (loop_count <= 0)
+        return 0;
+
+    // a gray frame letterboxes to exactly det_target_size x det_target_size
+    const int target_size = det_target_size;
+    cv::Mat rgb(target_size, target_size, CV_8UC3, cv::Scalar(114, 114, 114));
+
+    // cold allocator pools, lazy pipeline state and weight page-ins are paid here
+    double latency = 0.0;
+    for (int i = 0; i < loop_count; i++)
+    {
+        std::vector<Object> objects;
+
+        double t0 = ncnn::get_current_time();
+        detect(rgb, objects);
+        double t1 = ncnn::get_current_time();
+
+        latency = t1 - t0;
+    }
+
+    {
+        ncnn::MutexLockGuard g(warmup_lock);
+        ready = true;
+        warm_latency = (float)latency;
+    }
+
+    return 0;
+}
+
+void YOLO11::set_warming()
+{
+    ncnn::MutexLockGuard g(warmup_lock);
+    ready = false;
+}
+
+bool YOLO11::is_ready() const
+{
+    ncnn::MutexLockGuard g(warmup_lock);
+    return ready;
+}
+
+float YOLO11::get_warm_latency() const
+{
+    ncnn::MutexLockGuard g(warmup_lock);
+    return warm_latency;
+}
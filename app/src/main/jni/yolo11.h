@@ -17,7 +17,17 @@
 
 #include <opencv2/core/core.hpp>
 
+#include <atomic>
+#include <map>
+#include <string>
+
+#include <allocator.h>
 #include <net.h>
+#include <platform.h>
+
+#include "yolo11nms.h"
+
+class ModelRewriter;
 
 struct KeyPoint
 {
@@ -36,56 +46,364 @@ struct Object
     std::vector<KeyPoint> keypoints;
 };
 
+#if YOLO11_POOL_STATS
+// pool allocator that counts how many requests were served from memory it handed out before
+// ncnn does not expose the pool internals, a reused pointer is taken as a hit
+// every request takes a lock and a map lookup, so it is only built with -DYOLO11NCNN_POOL_STATS=ON
+template<class T>
+class CountingPoolAllocator : public T
+{
+public:
+    CountingPoolAllocator() : requests(0), hits(0), pool_size(0) {}
+
+    virtual void* fastMalloc(size_t size)
+    {
+        void* ptr = T::fastMalloc(size);
+
+        ncnn::MutexLockGuard g(stats_lock);
+
+        requests++;
+
+        std::map<void*, size_t>::iterator it = seen.find(ptr);
+        if (it != seen.end() && it->second >= size)
+        {
+            hits++;
+        }
+        else
+        {
+            pool_size += size - (it != seen.end() ? it->second : 0);
+            seen[ptr] = size;
+        }
+
+        return ptr;
+    }
+
+    // the pool hands its memory back, forget the pointers it gave out
+    void clear()
+    {
+        T::clear();
+
+        ncnn::MutexLockGuard g(stats_lock);
+
+        seen.clear();
+        pool_size = 0;
+    }
+
+    void get_stats(size_t& _requests, size_t& _hits, size_t& _pool_size) const
+    {
+        ncnn::MutexLockGuard g(stats_lock);
+
+        _requests = requests;
+        _hits = hits;
+        _pool_size = pool_size;
+    }
+
+private:
+    mutable ncnn::Mutex stats_lock;
+    std::map<void*, size_t> seen;
+    size_t requests;
+    size_t hits;
+    size_t pool_size;
+};
+
+typedef CountingPoolAllocator<ncnn::UnlockedPoolAllocator> BlobPoolAllocator;
+typedef CountingPoolAllocator<ncnn::PoolAllocator> WorkspacePoolAllocator;
+#else
+typedef ncnn::UnlockedPoolAllocator BlobPoolAllocator;
+typedef ncnn::PoolAllocator WorkspacePoolAllocator;
+#endif // YOLO11_POOL_STATS
+
+// per-thread inference state, the allocators of one extractor at a time
+// pooled so frames after the first do not go through malloc
+// blob memory is only touched by the detecting thread, workspace may be used from omp workers
+struct YOLO11Context
+{
+    YOLO11Context() : num_threads(0), prob_threshold(0.f) {}
+
+    BlobPoolAllocator blob_allocator;
+    WorkspacePoolAllocator workspace_allocator;
+
+    // threads for the extractor and pre/post-processing layers, 0 keeps the net default
+    int num_threads;
+
+    // det candidate threshold of detects on this context, 0 keeps the model's
+    // like num_threads it is cleared when the context is released
+    float prob_threshold;
+
+    // proposals of each row band of the parallel decode, kept so their capacity carries over frames
+    std::vector<std::vector<Detection> > band_proposals;
+    NmsWorkspace nms_workspace;
+};
+
+// rgb frame scaled to fit target_size and padded with 114, normalized to 0~1 unless the model folded it
+struct Letterbox
+{
+    int img_w;
+    int img_h;
+    float scale;
+    int wpad;
+    int hpad;
+    ncnn::Mat in_pad;
+};
+
+// per-stream state of YOLO11_det::detect_incremental, one per camera or video and never shared
+// keeps the last input and the net features at the local cut, see ModelRewriter::find_local_cut
+struct FeatureCache
+{
+    FeatureCache();
+
+    // forget the cached frame, the next detect runs whole, stats are kept
+    void reset();
+
+    // mean absolute difference in 0~255 over a 32x32 block that marks the block changed
+    float change_threshold;
+    // changed area over the input beyond which the frame runs whole
+    float max_coverage;
+    // pixels of context recomputed around the changed blocks, rounded up to 32
+    // 0 takes twice the receptive field radius of the local front, so every feature it reaches is refreshed
+    int halo;
+    // every n-th incremental frame also runs whole, is compared and resyncs the cache, 0 never
+    int parity_interval;
+
+    int frames;
+    int full_frames;
+    int incremental_frames;
+    int unchanged_frames;
+    float coverage_sum;    // recomputed fraction of the input summed over incremental frames
+    int parity_checks;
+    int parity_mismatches; // checks whose detections differed
+    float parity_max_diff; // largest absolute difference of the raw output over all checks
+
+    const void* owner;
+    ncnn::Mat last_in;
+    std::vector<ncnn::Mat> features;
+    std::vector<Object> last_objects;
+    int since_parity;
+};
+
+// the loaded net, its weights and pipelines are shared read-only by every detect
+// all per-frame state lives in a YOLO11Context, so any number of threads may detect at once
 class YOLO11
 {
 public:
+    YOLO11();
     virtual ~YOLO11();
 
     int load(const char* parampath, const char* modelpath, bool use_gpu = false);
     int load(AAssetManager* mgr, const char* parampath, const char* modelpath, bool use_gpu = false);
 
+    // detects pick it up from their next frame, a frame already letterboxed keeps its size
     void set_det_target_size(int target_size);
+    int get_det_target_size() const;
+
+    // map the weights file instead of copying it into the heap, weights stay file-backed
+    // prefetch asks the kernel to read the mapping ahead with madvise(MADV_WILLNEED)
+    void set_weights_mmap(bool enable, bool prefetch = false);
 
-    virtual int detect(const cv::Mat& rgb, std::vector<Object>& objects) = 0;
+    // size in bytes of the loaded weights file
+    size_t get_weights_size() const;
+
+    // fold the 1/255 input normalization into the first convolution at load, frames then go in as 0~255
+    // needs mapped weights, without them normalization stays a per-frame pass
+    void set_fold_normalize(bool enable);
+    // the loaded net takes 0~255 input
+    bool is_normalize_folded() const;
+
+    // keep the rewritten model in dir with fp16 weights expanded to fp32, keyed by a hash of the model and options
+    // later loads map the cached weights and skip rewriting and fp16 conversion, empty dir disables
+    // this is the graph before ncnn sees it, layers still pack and convert their weights in create_pipeline
+    void set_rewrite_cache(const std::string& dir);
+
+    // keep only these classes in the head, cut at load from the class convolutions so the net and the decode
+    // both scan fewer channels, labels stay the original class ids, empty keeps every class
+    // applies from the next load or reload and needs mapped weights, cls models keep every class
+    void set_class_subset(const std::vector<int>& classes);
+    const std::vector<int>& get_class_subset() const;
+    // the loaded head was cut to the class subset
+    bool is_class_subset_applied() const;
+
+    // rebuild the net from the param and weights kept mapped since load, no file is read again
+    // like load, not to be called while detecting
+    int reload();
+
+    // run loop_count dummy inferences at det_target_size on the calling thread
+    // the model reports not ready while they run, loop_count 0 makes it ready immediately
+    int warmup(int loop_count);
+    bool is_ready() const;
+    // report not ready until the next warmup, for a published model about to be reloaded
+    void set_warming();
+    // milliseconds of the last warm-up inference, 0 if not measured
+    float get_warm_latency() const;
+
+    // detect on a context borrowed from this instance, safe to call from several threads
+    int detect(const cv::Mat& rgb, std::vector<Object>& objects);
+
+    // borrow an idle context, a new one is created when all are in use
+    YOLO11Context* acquire_context();
+    void release_context(YOLO11Context* ctx);
+
+    // detect every image on its own single-threaded extractor, num_threads images at a time
+    // all share this net and its weights, results are in input order
+    // num_threads 0 uses the net default thread count
+    int detect_batch(const std::vector<cv::Mat>& rgbs, std::vector<std::vector<Object> >& objects, int num_threads = 0);
+
+    // log pool size and hit rate summed over all contexts, only the context count without YOLO11_POOL_STATS
+    void print_pool_stats() const;
+
+    // every ncnn::Mat of the frame, net blobs and pre/post-processing alike, comes from ctx
+    int detect(const cv::Mat& rgb, std::vector<Object>& objects, YOLO11Context& ctx);
+
+    // input this model expects, det_target_size padded to a multiple of 32 unless overridden
+    // square pads to target_size x target_size
+    virtual void get_letterbox_size(int& target_size, bool& square) const;
+
+    // normalize false leaves 0~255 pixels for a model that folded the normalization
+    static void letterbox(const cv::Mat& rgb, int target_size, bool square, bool normalize, Letterbox& lb, YOLO11Context& ctx);
+
+    // detect on a letterbox made for get_letterbox_size, lb is only read
+    virtual int detect(const Letterbox& lb, std::vector<Object>& objects, YOLO11Context& ctx) = 0;
     virtual int draw(cv::Mat& rgb, const std::vector<Object>& objects) = 0;
 
 protected:
+    // graph edits of the task on top of the normalization fold, made once before the rewrite cache is written
+    virtual void rewrite_graph(ModelRewriter& rw);
+    // rewrite_graph options other than the fold and the class subset, part of the rewrite cache key
+    virtual int graph_variant() const;
+
+    // the loaded graph ends in a blob of this name
+    bool has_output(const char* name) const;
+
+    // head channel to class id of a head cut to the class subset
+    void remap_labels(std::vector<Object>& objects) const;
+
+    // threads the proposal decode of a frame runs on, the extractor threads of ctx
+    int get_decode_threads(const YOLO11Context& ctx) const;
+
     ncnn::Net yolo11;
-    int det_target_size;
+    // read once per frame by any detecting thread, set by the thread that owns the model
+    std::atomic<int> det_target_size;
+
+    // blobs at the local cut of the loaded graph, empty when it has none
+    std::vector<std::string> local_cut_blobs;
+    // input pixels the receptive field of a feature at each cut blob reaches from its position
+    std::vector<int> local_cut_radii;
+
+private:
+    void inspect_graph(const std::string& param);
+    int load_weights(const std::string& param, const char* modelpath);
+    int load_weights(const std::string& param, AAssetManager* mgr, const char* modelpath);
+    int load_mapped(const std::string& param, const unsigned char* mem, size_t size);
+    std::string rewrite_cache_key(const std::string& param, const unsigned char* mem, size_t size) const;
+    int load_cached(const std::string& path);
+    void release_rewritten();
+    void release_weights();
+
+    bool weights_mmap;
+    bool weights_prefetch;
+    size_t weights_size;
+    void* weights_mapped;
+    size_t weights_mapped_size;
+    AAsset* weights_asset;
+
+    // the original model, kept for reload even when the net runs from the rewrite cache
+    std::string source_param;
+    const unsigned char* source_mem;
+    size_t source_size;
+
+    bool fold_normalize;
+    bool normalize_folded;
+    // holds the rewritten blobs the net references
+    ModelRewriter* rewriter;
+    std::string rewrite_cache_dir;
+    void* cache_mapped;
+    size_t cache_mapped_size;
+
+    std::vector<int> class_subset;
+    // head channel to class id, empty when the head is whole
+    std::vector<int> class_map;
+
+    mutable ncnn::Mutex warmup_lock;
+    bool ready;
+    float warm_latency;
+
+    // contexts are kept after use so their pools stay warm
+    mutable ncnn::Mutex context_lock;
+    std::vector<YOLO11Context*> contexts;
+    std::vector<YOLO11Context*> free_contexts;
 };
 
 class YOLO11_det : public YOLO11
 {
 public:
-    virtual int detect(const cv::Mat& rgb, std::vector<Object>& objects);
+    YOLO11_det();
+
+    // both go to the fused decode layer with every extractor, so they apply from the next frame
+    // YOLO11Context::prob_threshold overrides the threshold for one borrowed context
+    void set_prob_threshold(float prob_threshold);
+    void set_max_candidates(int max_candidates);
+    float get_prob_threshold() const;
+
+    // split the head at load into anchor-major box rows and a class-major score plane, see yolo11_det.cpp
+    // applies from the next load or reload
+    void set_split_head(bool enable);
+    bool is_head_split() const;
+
+    using YOLO11::detect;
+    virtual int detect(const Letterbox& lb, std::vector<Object>& objects, YOLO11Context& ctx);
     virtual int draw(cv::Mat& rgb, const std::vector<Object>& objects);
+
+    // for a mostly static scene, rerun the local front of the net only on the 32x32 blocks that changed
+    // since the last frame plus a halo, splice those features into the cached ones and run the tail whole
+    // falls back to a whole detect on the first frame, a size change or too much change
+    int detect_incremental(const cv::Mat& rgb, std::vector<Object>& objects, FeatureCache& cache);
+
+protected:
+    // cut the class subset, then split the head or append YOLO11Decode after out0
+    virtual void rewrite_graph(ModelRewriter& rw);
+    virtual int graph_variant() const;
+
+private:
+    // written by the thread that owns the model while others detect, each detect reads them once
+    std::atomic<float> prob_threshold;
+    std::atomic<int> max_candidates;
+    bool split_head;
 };
 
 class YOLO11_seg : public YOLO11
 {
 public:
-    virtual int detect(const cv::Mat& rgb, std::vector<Object>& objects);
+
+    using YOLO11::detect;
+    virtual int detect(const Letterbox& lb, std::vector<Object>& objects, YOLO11Context& ctx);
     virtual int draw(cv::Mat& rgb, const std::vector<Object>& objects);
 };
 
 class YOLO11_pose : public YOLO11
 {
 public:
-    virtual int detect(const cv::Mat& rgb, std::vector<Object>& objects);
+
+    using YOLO11::detect;
+    virtual int detect(const Letterbox& lb, std::vector<Object>& objects, YOLO11Context& ctx);
     virtual int draw(cv::Mat& rgb, const std::vector<Object>& objects);
 };
 
 class YOLO11_cls : public YOLO11
 {
 public:
-    virtual int detect(const cv::Mat& rgb, std::vector<Object>& objects);
+
+    virtual void get_letterbox_size(int& target_size, bool& square) const;
+
+    using YOLO11::detect;
+    virtual int detect(const Letterbox& lb, std::vector<Object>& objects, YOLO11Context& ctx);
     virtual int draw(cv::Mat& rgb, const std::vector<Object>& objects);
 };
 
 class YOLO11_obb : public YOLO11
 {
 public:
-    virtual int detect(const cv::Mat& rgb, std::vector<Object>& objects);
+
+    using YOLO11::detect;
+    virtual int detect(const Letterbox& lb, std::vector<Object>& objects, YOLO11Context& ctx);
     virtual int draw(cv::Mat& rgb, const std::vector<Object>& objects);
 };
 
@@ -53,43 +53,18 @@ static void get_topk(const ncnn::Mat& cls_scores, int topk, std::vector<Object>&
     }
 }
 
-int YOLO11_cls::detect(const cv::Mat& rgb, std::vector<Object>& objects)
+int YOLO11_cls::detect(const Letterbox& lb, std::vector<Object>& objects, YOLO11Context& ctx)
 {
-    const int target_size = 224;
     const int topk = 5;
 
-    int img_w = rgb.cols;
-    int img_h = rgb.rows;
-
-    // letterbox pad
-    int w = img_w;
-    int h = img_h;
-    float scale = 1.f;
-    if (w > h)
-    {
-        scale = (float)target_size / w;
-        w = target_size;
-        h = h * scale;
-    }
-    else
-    {
-        scale = (float)target_size / h;
-        h = target_size;
-        w = w * scale;
-    }
-
-    ncnn::Mat in = ncnn::Mat::from_pixels_resize(rgb.data, ncnn::Mat::PIXEL_RGB, img_w, img_h, w, h);
-
-    // letterbox pad to target_size rectangle
-    int wpad = target_size - w;
-    int hpad = target_size - h;
-    ncnn::Mat in_pad;
-    ncnn::copy_make_border(in, in_pad, hpad / 2, hpad - hpad / 2, wpad / 2, wpad - wpad / 2, ncnn::BORDER_CONSTANT, 114.f);
-
-    const float norm_vals[3] = {1 / 255.f, 1 / 255.f, 1 / 255.f};
-    in_pad.substract_mean_normalize(0, norm_vals);
+    // letterboxed and normalized once per frame, possibly shared with other models
+    const ncnn::Mat& in_pad = lb.in_pad;
 
     ncnn::Extractor ex = yolo11.create_extractor();
+    ex.set_blob_allocator(&ctx.blob_allocator);
+    ex.set_workspace_allocator(&ctx.workspace_allocator);
+    if (ctx.num_threads > 0)
+        ex.set_num_threads(ctx.num_threads);
 
     ex.input("in0", in_pad);
 
@@ -102,6 +77,12 @@ int YOLO11_cls::detect(const cv::Mat& rgb, std::vector<Object>& objects)
     return 0;
 }
 
+void YOLO11_cls::get_letterbox_size(int& target_size, bool& square) const
+{
+    target_size = 224;
+    square = true;
+}
+
 int YOLO11_cls::draw(cv::Mat& rgb, const std::vector<Object>& objects)
 {
     static const char* class_names[] = {
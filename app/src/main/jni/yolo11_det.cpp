@@ -84,316 +84,736 @@
 //       \|     |     |     |     |           .          |
 //        +-----+-----+-----+-----+----------------------+
 //
+// with set_split_head the head is rewritten at load into two blobs instead
+// boxes w=64 h=8400 keeps the bbox-reg rows, scores w=8400 h=80 holds one row of all anchors per class
+//
+//        |     all boxes (8400)      |
+//        +---------------------------+
+//        |0.1 0.0 0.0 0.5 ...........| class 0
+//        |0.0 0.9 0.0 0.0 ...........| class 1
+//        |             .             |
+//        +---------------------------+
+//
 
 #include "yolo11.h"
+#include "yolo11dfl.h"
+#include "yolo11scan.h"
+#include "modelrewrite.h"
 #include "myfontface.h"
 
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 
-static inline float intersection_area(const Object& a, const Object& b)
+#include <android/log.h>
+
+#include <algorithm>
+
+#include <math.h>
+#include <string.h>
+
+#if __ARM_NEON
+#include <arm_neon.h>
+#endif // __ARM_NEON
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+
+static inline float sigmoid(float x)
 {
-    cv::Rect_<float> inter = a.rect & b.rect;
-    return inter.area();
+    return 1.0f / (1.0f + expf(-x));
 }
 
-static void qsort_descent_inplace(std::vector<Object>& objects, int left, int right)
+static void generate_proposals(const ncnn::Mat& pred, const ProposalBand& band, const ncnn::Mat& in_pad, float score_threshold, std::vector<Detection>& objects)
 {
-    int i = left;
-    int j = right;
-    float p = objects[(left + right) / 2].prob;
+    const int w = in_pad.w;
 
-    while (i <= j)
-    {
-        while (objects[i].prob > p)
-            i++;
+    const int stride = band.stride;
+    const int pred_row_offset = band.row_offset;
+    const int num_grid_x = w / stride;
 
-        while (objects[j].prob < p)
-            j--;
+    const int reg_max_1 = 16;
+    const int num_class = pred.w - reg_max_1 * 4; // number of classes. 80 for COCO
 
-        if (i <= j)
+    for (int y = band.y0; y < band.y1; y++)
+    {
+        for (int x = 0; x < num_grid_x; x++)
         {
-            // swap
-            std::swap(objects[i], objects[j]);
+            const float* pred_grid = pred.row(pred_row_offset + y * num_grid_x + x);
 
-            i++;
-            j--;
-        }
-    }
+            // find label with max score, compared as a logit
+            const float* pred_score = pred_grid + reg_max_1 * 4;
+            float score = max_score(pred_score, num_class);
 
-    // #pragma omp parallel sections
-    {
-        // #pragma omp section
-        {
-            if (left < j) qsort_descent_inplace(objects, left, j);
-        }
-        // #pragma omp section
-        {
-            if (i < right) qsort_descent_inplace(objects, i, right);
+            if (score >= score_threshold)
+            {
+                const int label = find_score(pred_score, num_class, score);
+                score = sigmoid(score);
+
+                float pred_ltrb[4];
+                dfl_decode(pred_grid, reg_max_1, pred_ltrb);
+                for (int k = 0; k < 4; k++)
+                {
+                    pred_ltrb[k] *= stride;
+                }
+
+                float pb_cx = (x + 0.5f) * stride;
+                float pb_cy = (y + 0.5f) * stride;
+
+                float x0 = pb_cx - pred_ltrb[0];
+                float y0 = pb_cy - pred_ltrb[1];
+                float x1 = pb_cx + pred_ltrb[2];
+                float y1 = pb_cy + pred_ltrb[3];
+
+                Detection det;
+                det.x0 = x0;
+                det.y0 = y0;
+                det.x1 = x1;
+                det.y1 = y1;
+                det.angle = 0.f;
+                det.prob = score;
+                det.label = label;
+                det.gindex = pred_row_offset + y * num_grid_x + x;
+
+                objects.push_back(det);
+            }
         }
     }
 }
 
-static void qsort_descent_inplace(std::vector<Object>& objects)
+static void generate_proposals(const ncnn::Mat& pred, const std::vector<int>& strides, const ncnn::Mat& in_pad, float prob_threshold, int num_threads, std::vector<std::vector<Detection> >& band_objects, std::vector<Detection>& objects)
 {
-    if (objects.empty())
-        return;
+    const float score_threshold = prob_to_logit(prob_threshold);
+
+    std::vector<ProposalBand> bands;
+    plan_proposal_bands(in_pad.w, in_pad.h, strides, num_threads, bands);
+
+    const int band_count = (int)bands.size();
+    if ((int)band_objects.size() < band_count)
+        band_objects.resize(band_count);
+
+    // every band fills its own list, nothing is shared between threads
+    #pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+    for (int i = 0; i < band_count; i++)
+    {
+        band_objects[i].clear();
+        generate_proposals(pred, bands[i], in_pad, score_threshold, band_objects[i]);
+    }
 
-    qsort_descent_inplace(objects, 0, objects.size() - 1);
+    // joined in band order, the proposals come out as a single thread would find them
+    for (int i = 0; i < band_count; i++)
+    {
+        objects.insert(objects.end(), band_objects[i].begin(), band_objects[i].end());
+    }
 }
 
-static void nms_sorted_bboxes(const std::vector<Object>& objects, std::vector<int>& picked, float nms_threshold, bool agnostic = false)
+// boxes in the original image from the raw head output
+static void generate_proposals_split(const ncnn::Mat& boxes, const ncnn::Mat& scores, const std::vector<int>& strides, const ncnn::Mat& in_pad, float prob_threshold, std::vector<Detection>& objects)
 {
-    picked.clear();
+    const int w = in_pad.w;
+    const int h = in_pad.h;
 
-    const int n = objects.size();
+    const int reg_max_1 = 16;
+    const int num_anchors = scores.w;
+    const int num_class = scores.h;
 
-    std::vector<float> areas(n);
-    for (int i = 0; i < n; i++)
+    // running max and argmax over the class rows, contiguous anchors at a time
+    std::vector<float> max_scores((const float*)scores.row(0), (const float*)scores.row(0) + num_anchors);
+    std::vector<int> labels(num_anchors, 0);
+    for (int k = 1; k < num_class; k++)
     {
-        areas[i] = objects[i].rect.area();
+        const float* ptr = scores.row(k);
+        float* max_ptr = &max_scores[0];
+        int* label_ptr = &labels[0];
+
+        int i = 0;
+#if __ARM_NEON
+        int32x4_t _k = vdupq_n_s32(k);
+        for (; i + 3 < num_anchors; i += 4)
+        {
+            float32x4_t _p = vld1q_f32(ptr + i);
+            float32x4_t _max = vld1q_f32(max_ptr + i);
+            uint32x4_t _gt = vcgtq_f32(_p, _max);
+            vst1q_f32(max_ptr + i, vbslq_f32(_gt, _p, _max));
+            vst1q_s32(label_ptr + i, vbslq_s32(_gt, _k, vld1q_s32(label_ptr + i)));
+        }
+#elif __SSE2__
+        __m128i _k = _mm_set1_epi32(k);
+        for (; i + 3 < num_anchors; i += 4)
+        {
+            __m128 _p = _mm_loadu_ps(ptr + i);
+            __m128 _max = _mm_loadu_ps(max_ptr + i);
+            __m128 _gt = _mm_cmpgt_ps(_p, _max);
+            __m128i _gti = _mm_castps_si128(_gt);
+            __m128i _label = _mm_loadu_si128((const __m128i*)(label_ptr + i));
+            _mm_storeu_ps(max_ptr + i, _mm_or_ps(_mm_and_ps(_gt, _p), _mm_andnot_ps(_gt, _max)));
+            _mm_storeu_si128((__m128i*)(label_ptr + i), _mm_or_si128(_mm_and_si128(_gti, _k), _mm_andnot_si128(_gti, _label)));
+        }
+#endif // __ARM_NEON
+        for (; i < num_anchors; i++)
+        {
+            if (ptr[i] > max_ptr[i])
+            {
+                max_ptr[i] = ptr[i];
+                label_ptr[i] = k;
+            }
+        }
     }
 
-    for (int i = 0; i < n; i++)
+    const float score_threshold = prob_to_logit(prob_threshold);
+
+    int anchor = 0;
+    for (size_t i = 0; i < strides.size(); i++)
     {
-        const Object& a = objects[i];
+        const int stride = strides[i];
+
+        const int num_grid_x = w / stride;
+        const int num_grid_y = h / stride;
 
-        int keep = 1;
-        for (int j = 0; j < (int)picked.size(); j++)
+        for (int y = 0; y < num_grid_y; y++)
         {
-            const Object& b = objects[picked[j]];
+            for (int x = 0; x < num_grid_x; x++, anchor++)
+            {
+                if (anchor >= num_anchors || max_scores[anchor] < score_threshold)
+                    continue;
 
-            if (!agnostic && a.label != b.label)
-                continue;
+                // box bins are only read for the anchors that pass
+                const float* bins = boxes.row(anchor);
 
-            // intersection over union
-            float inter_area = intersection_area(a, b);
-            float union_area = areas[i] + areas[picked[j]] - inter_area;
-            // float IoU = inter_area / union_area
-            if (inter_area / union_area > nms_threshold)
-                keep = 0;
-        }
+                float pb_cx = (x + 0.5f) * stride;
+                float pb_cy = (y + 0.5f) * stride;
 
-        if (keep)
-            picked.push_back(i);
+                float pred_ltrb[4];
+                dfl_decode(bins, reg_max_1, pred_ltrb);
+
+                float x0 = pb_cx - pred_ltrb[0] * stride;
+                float y0 = pb_cy - pred_ltrb[1] * stride;
+                float x1 = pb_cx + pred_ltrb[2] * stride;
+                float y1 = pb_cy + pred_ltrb[3] * stride;
+
+                Detection det;
+                det.x0 = x0;
+                det.y0 = y0;
+                det.x1 = x1;
+                det.y1 = y1;
+                det.angle = 0.f;
+                det.prob = sigmoid(max_scores[anchor]);
+                det.label = labels[anchor];
+                det.gindex = anchor;
+
+                objects.push_back(det);
+            }
+        }
     }
 }
 
-static inline float sigmoid(float x)
+// sort, nms, undo the letterbox
+static void finish_objects(const std::vector<Detection>& proposals, const Letterbox& lb, int max_candidates, NmsWorkspace& ws, std::vector<Object>& objects)
 {
-    return 1.0f / (1.0f + expf(-x));
-}
+    const float nms_threshold = 0.45f;
 
-static void generate_proposals(const ncnn::Mat& pred, int stride, const ncnn::Mat& in_pad, float prob_threshold, std::vector<Object>& objects)
-{
-    const int w = in_pad.w;
-    const int h = in_pad.h;
+    const int img_w = lb.img_w;
+    const int img_h = lb.img_h;
 
-    const int num_grid_x = w / stride;
-    const int num_grid_y = h / stride;
+    const float scale = lb.scale;
+    const int wpad = lb.wpad;
+    const int hpad = lb.hpad;
 
-    const int reg_max_1 = 16;
-    const int num_class = pred.w - reg_max_1 * 4; // number of classes. 80 for COCO
+    // apply nms with nms_threshold to the max_candidates highest scores
+    std::vector<int> picked;
+    nms_detections(proposals, picked, nms_threshold, max_candidates, 0, false, ws);
 
-    for (int y = 0; y < num_grid_y; y++)
+    int count = picked.size();
+
+    // fresh objects, the caller's vector may hold a previous frame
+    objects.clear();
+    objects.resize(count);
+    for (int i = 0; i < count; i++)
     {
-        for (int x = 0; x < num_grid_x; x++)
+        const Detection& det = proposals[picked[i]];
+
+        // adjust offset to original unpadded
+        float x0 = (det.x0 - (wpad / 2)) / scale;
+        float y0 = (det.y0 - (hpad / 2)) / scale;
+        float x1 = (det.x1 - (wpad / 2)) / scale;
+        float y1 = (det.y1 - (hpad / 2)) / scale;
+
+        // clip
+        x0 = std::max(std::min(x0, (float)(img_w - 1)), 0.f);
+        y0 = std::max(std::min(y0, (float)(img_h - 1)), 0.f);
+        x1 = std::max(std::min(x1, (float)(img_w - 1)), 0.f);
+        y1 = std::max(std::min(y1, (float)(img_h - 1)), 0.f);
+
+        objects[i].rect.x = x0;
+        objects[i].rect.y = y0;
+        objects[i].rect.width = x1 - x0;
+        objects[i].rect.height = y1 - y0;
+        objects[i].label = det.label;
+        objects[i].prob = det.prob;
+        objects[i].gindex = det.gindex;
+    }
+
+    // sort objects by area
+    struct
+    {
+        bool operator()(const Object& a, const Object& b) const
         {
-            const ncnn::Mat pred_grid = pred.row_range(y * num_grid_x + x, 1);
+            return a.rect.area() > b.rect.area();
+        }
+    } objects_area_greater;
+    std::sort(objects.begin(), objects.end(), objects_area_greater);
+}
 
-            // find label with max score
-            int label = -1;
-            float score = -FLT_MAX;
-            {
-                const ncnn::Mat pred_score = pred_grid.range(reg_max_1 * 4, num_class);
+static void decode_objects(const ncnn::Mat& out, const Letterbox& lb, float prob_threshold, int max_candidates, int num_threads, YOLO11Context& ctx, std::vector<Object>& objects)
+{
+    // ultralytics/cfg/models/v8/yolo11.yaml
+    std::vector<int> strides(3);
+    strides[0] = 8;
+    strides[1] = 16;
+    strides[2] = 32;
 
-                for (int k = 0; k < num_class; k++)
-                {
-                    float s = pred_score[k];
-                    if (s > score)
-                    {
-                        label = k;
-                        score = s;
-                    }
-                }
+    std::vector<Detection> proposals;
+    generate_proposals(out, strides, lb.in_pad, prob_threshold, num_threads, ctx.band_proposals, proposals);
 
-                score = sigmoid(score);
-            }
+    finish_objects(proposals, lb, max_candidates, ctx.nms_workspace, objects);
+}
 
-            if (score >= prob_threshold)
-            {
-                ncnn::Mat pred_bbox = pred_grid.range(0, reg_max_1 * 4).reshape(reg_max_1, 4);
+static void decode_split_objects(const ncnn::Mat& boxes, const ncnn::Mat& scores, const Letterbox& lb, float prob_threshold, int max_candidates, YOLO11Context& ctx, std::vector<Object>& objects)
+{
+    // ultralytics/cfg/models/v8/yolo11.yaml
+    std::vector<int> strides(3);
+    strides[0] = 8;
+    strides[1] = 16;
+    strides[2] = 32;
 
-                {
-                    ncnn::Layer* softmax = ncnn::create_layer("Softmax");
+    std::vector<Detection> proposals;
+    generate_proposals_split(boxes, scores, strides, lb.in_pad, prob_threshold, proposals);
 
-                    ncnn::ParamDict pd;
-                    pd.set(0, 1); // axis
-                    pd.set(1, 1);
-                    softmax->load_param(pd);
+    finish_objects(proposals, lb, max_candidates, ctx.nms_workspace, objects);
+}
 
-                    ncnn::Option opt;
-                    opt.num_threads = 1;
-                    opt.use_packing_layout = false;
+// rows of the YOLO11Decode output, already thresholded and boxed in letterbox pixels
+static void decode_fused_objects(const ncnn::Mat& dets, const Letterbox& lb, int max_candidates, YOLO11Context& ctx, std::vector<Object>& objects)
+{
+    const int count = dets.empty() ? 0 : std::min((int)dets.row(0)[0], dets.h - 1);
 
-                    softmax->create_pipeline(opt);
+    std::vector<Detection> proposals(count);
+    for (int i = 0; i < count; i++)
+    {
+        const float* p = dets.row(i + 1);
+
+        Detection& det = proposals[i];
+        det.x0 = p[0];
+        det.y0 = p[1];
+        det.x1 = p[2];
+        det.y1 = p[3];
+        det.angle = 0.f;
+        det.prob = p[4];
+        det.label = (int)p[5];
+        det.gindex = -1; // the fused decode does not report anchors
+    }
 
-                    softmax->forward_inplace(pred_bbox, opt);
+    finish_objects(proposals, lb, max_candidates, ctx.nms_workspace, objects);
+}
 
-                    softmax->destroy_pipeline(opt);
+static ncnn::Extractor create_extractor(const ncnn::Net& net, YOLO11Context& ctx)
+{
+    ncnn::Extractor ex = net.create_extractor();
+    ex.set_blob_allocator(&ctx.blob_allocator);
+    ex.set_workspace_allocator(&ctx.workspace_allocator);
+    if (ctx.num_threads > 0)
+        ex.set_num_threads(ctx.num_threads);
 
-                    delete softmax;
-                }
+    return ex;
+}
 
-                float pred_ltrb[4];
-                for (int k = 0; k < 4; k++)
-                {
-                    float dis = 0.f;
-                    const float* dis_after_sm = pred_bbox.row(k);
-                    for (int l = 0; l < reg_max_1; l++)
-                    {
-                        dis += l * dis_after_sm[l];
-                    }
+// whole net on in_pad, the cut features are kept out of the context pools since the cache outlives the frame
+static void forward_full(const ncnn::Net& net, const ncnn::Mat& in_pad, const std::vector<std::string>& cut_blobs, std::vector<ncnn::Mat>& features, ncnn::Mat& out, YOLO11Context& ctx)
+{
+    ncnn::Extractor ex = create_extractor(net, ctx);
 
-                    pred_ltrb[k] = dis * stride;
-                }
+    ex.input("in0", in_pad);
 
-                float pb_cx = (x + 0.5f) * stride;
-                float pb_cy = (y + 0.5f) * stride;
+    features.resize(cut_blobs.size());
+    for (size_t i = 0; i < cut_blobs.size(); i++)
+    {
+        ncnn::Mat feature;
+        ex.extract(cut_blobs[i].c_str(), feature);
+        features[i] = feature.clone();
+    }
 
-                float x0 = pb_cx - pred_ltrb[0];
-                float y0 = pb_cy - pred_ltrb[1];
-                float x1 = pb_cx + pred_ltrb[2];
-                float y1 = pb_cy + pred_ltrb[3];
+    ex.extract("out0", out);
+}
 
-                Object obj;
-                obj.rect.x = x0;
-                obj.rect.y = y0;
-                obj.rect.width = x1 - x0;
-                obj.rect.height = y1 - y0;
-                obj.label = label;
-                obj.prob = score;
+// copy a w x h window of every channel from src at sx,sy to dst at dx,dy
+static void copy_window(const ncnn::Mat& src, int sx, int sy, ncnn::Mat& dst, int dx, int dy, int w, int h)
+{
+    for (int q = 0; q < src.c; q++)
+    {
+        const ncnn::Mat src_channel = src.channel(q);
+        ncnn::Mat dst_channel = dst.channel(q);
 
-                objects.push_back(obj);
-            }
+        for (int y = 0; y < h; y++)
+        {
+            memcpy(dst_channel.row(dy + y) + dx, src_channel.row(sy + y) + sx, w * sizeof(float));
         }
     }
 }
 
-static void generate_proposals(const ncnn::Mat& pred, const std::vector<int>& strides, const ncnn::Mat& in_pad, float prob_threshold, std::vector<Object>& objects)
+static bool similar_objects(const std::vector<Object>& a, const std::vector<Object>& b)
 {
-    const int w = in_pad.w;
-    const int h = in_pad.h;
+    if (a.size() != b.size())
+        return false;
 
-    int pred_row_offset = 0;
-    for (size_t i = 0; i < strides.size(); i++)
+    for (size_t i = 0; i < a.size(); i++)
     {
-        const int stride = strides[i];
+        cv::Rect_<float> inter = a[i].rect & b[i].rect;
+        float union_area = a[i].rect.area() + b[i].rect.area() - inter.area();
+        if (a[i].label != b[i].label || inter.area() < union_area * 0.9f)
+            return false;
+    }
 
-        const int num_grid_x = w / stride;
-        const int num_grid_y = h / stride;
-        const int num_grid = num_grid_x * num_grid_y;
+    return true;
+}
 
-        generate_proposals(pred.row_range(pred_row_offset, num_grid), stride, in_pad, prob_threshold, objects);
-        pred_row_offset += num_grid;
-    }
+YOLO11_det::YOLO11_det()
+{
+    prob_threshold = 0.86f;
+    max_candidates = 300;
+    split_head = false;
 }
 
-int YOLO11_det::detect(const cv::Mat& rgb, std::vector<Object>& objects)
+void YOLO11_det::set_prob_threshold(float _prob_threshold)
 {
-    const int target_size = det_target_size;//640;
-    const float prob_threshold = 0.86f;
-    const float nms_threshold = 0.45f;
+    prob_threshold = _prob_threshold;
+}
 
-    int img_w = rgb.cols;
-    int img_h = rgb.rows;
+float YOLO11_det::get_prob_threshold() const
+{
+    return prob_threshold;
+}
 
-    // ultralytics/cfg/models/v8/yolo11.yaml
-    std::vector<int> strides(3);
-    strides[0] = 8;
-    strides[1] = 16;
-    strides[2] = 32;
-    const int max_stride = 32;
+void YOLO11_det::set_max_candidates(int _max_candidates)
+{
+    max_candidates = std::max(_max_candidates, 1);
+}
+
+void YOLO11_det::set_split_head(bool enable)
+{
+    split_head = enable;
+}
+
+bool YOLO11_det::is_head_split() const
+{
+    return has_output("scores");
+}
 
-    // letterbox pad to multiple of max_stride
-    int w = img_w;
-    int h = img_h;
-    float scale = 1.f;
-    if (w > h)
+int YOLO11_det::graph_variant() const
+{
+    return split_head ? 1 : 0;
+}
+
+void YOLO11_det::rewrite_graph(ModelRewriter& rw)
+{
+    YOLO11::rewrite_graph(rw);
+
+    // the split layout is decoded here, the fused decode reads the anchor-major rows
+    if (split_head)
     {
-        scale = (float)target_size / w;
-        w = target_size;
-        h = h * scale;
+        if (rw.split_head(16, "boxes", "scores") == 0)
+            return;
+
+        __android_log_print(ANDROID_LOG_WARN, "ncnn", "head not split, no matching head");
     }
-    else
+
+    bool has_out0 = false;
+    for (size_t i = 0; i < rw.layers.size(); i++)
     {
-        scale = (float)target_size / h;
-        h = target_size;
-        w = w * scale;
+        const std::vector<std::string>& tops = rw.layers[i].tops;
+        if (std::find(tops.begin(), tops.end(), "out0") != tops.end())
+            has_out0 = true;
+        if (std::find(tops.begin(), tops.end(), "dets") != tops.end())
+            return;
     }
 
-    ncnn::Mat in = ncnn::Mat::from_pixels_resize(rgb.data, ncnn::Mat::PIXEL_RGB, img_w, img_h, w, h);
+    if (!has_out0)
+        return;
 
-    // letterbox pad to target_size rectangle
-    int wpad = (w + max_stride - 1) / max_stride * max_stride - w;
-    int hpad = (h + max_stride - 1) / max_stride * max_stride - h;
-    ncnn::Mat in_pad;
-    ncnn::copy_make_border(in, in_pad, hpad / 2, hpad - hpad / 2, wpad / 2, wpad - wpad / 2, ncnn::BORDER_CONSTANT, 114.f);
+    ParamLayer input;
+    input.type = "Input";
+    input.name = "decode_param";
+    input.tops.push_back("decode_param");
+    input.set_int(0, 4);
+    rw.append_layer(input);
+
+    ParamLayer decode;
+    decode.type = "YOLO11Decode";
+    decode.name = "decode";
+    decode.bottoms.push_back("out0");
+    decode.bottoms.push_back("decode_param");
+    decode.tops.push_back("dets");
+    decode.set_int(0, 16);
+    rw.append_layer(decode);
+}
 
-    const float norm_vals[3] = {1 / 255.f, 1 / 255.f, 1 / 255.f};
-    in_pad.substract_mean_normalize(0, norm_vals);
+int YOLO11_det::detect(const Letterbox& lb, std::vector<Object>& objects, YOLO11Context& ctx)
+{
+    // the camera may set them while other threads detect, one frame decodes with one snapshot
+    const float frame_prob_threshold = ctx.prob_threshold > 0.f ? ctx.prob_threshold : (float)prob_threshold;
+    const int frame_max_candidates = max_candidates;
 
-    ncnn::Extractor ex = yolo11.create_extractor();
+    // letterboxed and normalized once per frame, possibly shared with other models
+    ncnn::Extractor ex = create_extractor(yolo11, ctx);
 
-    ex.input("in0", in_pad);
+    ex.input("in0", lb.in_pad);
+
+    if (has_output("scores"))
+    {
+        ncnn::Mat boxes;
+        ncnn::Mat scores;
+        ex.extract("boxes", boxes);
+        ex.extract("scores", scores);
+
+        decode_split_objects(boxes, scores, lb, frame_prob_threshold, frame_max_candidates, ctx, objects);
+
+        remap_labels(objects);
+
+        return 0;
+    }
+
+    // graphs rewritten at load end in the fused decode, others are decoded here
+    if (has_output("dets"))
+    {
+        float decode_param[4] = {(float)lb.in_pad.w, (float)lb.in_pad.h, frame_prob_threshold, (float)frame_max_candidates};
+        ex.input("decode_param", ncnn::Mat(4, decode_param));
+
+        ncnn::Mat dets;
+        ex.extract("dets", dets);
+
+        decode_fused_objects(dets, lb, frame_max_candidates, ctx, objects);
+
+        remap_labels(objects);
+
+        return 0;
+    }
 
     ncnn::Mat out;
     ex.extract("out0", out);
 
-    std::vector<Object> proposals;
-    generate_proposals(out, strides, in_pad, prob_threshold, proposals);
+    decode_objects(out, lb, frame_prob_threshold, frame_max_candidates, get_decode_threads(ctx), ctx, objects);
 
-    // sort all proposals by score from highest to lowest
-    qsort_descent_inplace(proposals);
+    remap_labels(objects);
 
-    // apply nms with nms_threshold
-    std::vector<int> picked;
-    nms_sorted_bboxes(proposals, picked, nms_threshold);
+    return 0;
+}
 
-    int count = picked.size();
+int YOLO11_det::detect_incremental(const cv::Mat& rgb, std::vector<Object>& objects, FeatureCache& cache)
+{
+    // the parity check compares the anchor-major out0
+    if (local_cut_blobs.empty() || has_output("scores"))
+        return detect(rgb, objects);
 
-    objects.resize(count);
-    for (int i = 0; i < count; i++)
+    const float frame_prob_threshold = prob_threshold;
+    const int frame_max_candidates = max_candidates;
+
+    YOLO11Context* ctx = acquire_context();
+
+    int target_size = 0;
+    bool square = false;
+    get_letterbox_size(target_size, square);
+
+    Letterbox lb;
+    letterbox(rgb, target_size, square, !is_normalize_folded(), lb, *ctx);
+
+    const ncnn::Mat& in_pad = lb.in_pad;
+    const int w = in_pad.w;
+    const int h = in_pad.h;
+
+    cache.frames++;
+
+    const bool cached = cache.owner == this && !cache.last_in.empty() && cache.last_in.w == w && cache.last_in.h == h;
+
+    // 32x32 blocks that changed since the cached input, and their bounding box in blocks
+    const int block = 32;
+    int bx0 = w / block;
+    int by0 = h / block;
+    int bx1 = -1;
+    int by1 = -1;
+    if (cached)
     {
-        objects[i] = proposals[picked[i]];
+        const float scale = is_normalize_folded() ? 1.f : 255.f;
 
-        // adjust offset to original unpadded
-        float x0 = (objects[i].rect.x - (wpad / 2)) / scale;
-        float y0 = (objects[i].rect.y - (hpad / 2)) / scale;
-        float x1 = (objects[i].rect.x + objects[i].rect.width - (wpad / 2)) / scale;
-        float y1 = (objects[i].rect.y + objects[i].rect.height - (hpad / 2)) / scale;
+        for (int by = 0; by < h / block; by++)
+        {
+            for (int bx = 0; bx < w / block; bx++)
+            {
+                float sum = 0.f;
+                for (int q = 0; q < in_pad.c; q++)
+                {
+                    for (int y = by * block; y < (by + 1) * block; y++)
+                    {
+                        const float* p0 = in_pad.channel(q).row(y) + bx * block;
+                        const float* p1 = cache.last_in.channel(q).row(y) + bx * block;
+                        for (int x = 0; x < block; x++)
+                        {
+                            sum += fabsf(p0[x] - p1[x]);
+                        }
+                    }
+                }
 
-        // clip
-        x0 = std::max(std::min(x0, (float)(img_w - 1)), 0.f);
-        y0 = std::max(std::min(y0, (float)(img_h - 1)), 0.f);
-        x1 = std::max(std::min(x1, (float)(img_w - 1)), 0.f);
-        y1 = std::max(std::min(y1, (float)(img_h - 1)), 0.f);
+                if (sum * scale / (in_pad.c * block * block) > cache.change_threshold)
+                {
+                    bx0 = std::min(bx0, bx);
+                    by0 = std::min(by0, by);
+                    bx1 = std::max(bx1, bx);
+                    by1 = std::max(by1, by);
+                }
+            }
+        }
+    }
 
-        objects[i].rect.x = x0;
-        objects[i].rect.y = y0;
-        objects[i].rect.width = x1 - x0;
-        objects[i].rect.height = y1 - y0;
+    if (cached && bx1 == -1)
+    {
+        // nothing moved, the last result stands
+        objects = cache.last_objects;
+        cache.unchanged_frames++;
+
+        release_context(ctx);
+        return 0;
     }
 
-    // sort objects by area
-    struct
+    // changed core and the tile around it, in input pixels
+    const int cx0 = bx0 * block;
+    const int cy0 = by0 * block;
+    const int cx1 = (bx1 + 1) * block;
+    const int cy1 = (by1 + 1) * block;
+    const float coverage = cached ? (float)(cx1 - cx0) * (cy1 - cy0) / (w * h) : 1.f;
+
+    ncnn::Mat out;
+    bool incremental = cached && coverage <= cache.max_coverage;
+    if (incremental)
     {
-        bool operator()(const Object& a, const Object& b) const
+        // features within their radius of a tile edge saw zero padding instead of the frame
+        // the default halo lets the deepest of them refresh everything its receptive field reaches
+        const int max_radius = *std::max_element(local_cut_radii.begin(), local_cut_radii.end());
+        const int halo = ((cache.halo > 0 ? cache.halo : 2 * max_radius) + block - 1) / block * block;
+        const int tx0 = std::max(cx0 - halo, 0);
+        const int ty0 = std::max(cy0 - halo, 0);
+        const int tx1 = std::min(cx1 + halo, w);
+        const int ty1 = std::min(cy1 + halo, h);
+
+        ncnn::Option pool_opt;
+        pool_opt.blob_allocator = &ctx->blob_allocator;
+        pool_opt.workspace_allocator = &ctx->workspace_allocator;
+
+        ncnn::Mat tile_in;
+        ncnn::copy_cut_border(in_pad, tile_in, ty0, h - ty1, tx0, w - tx1, pool_opt);
+
+        // the local front on the tile only
         {
-            return a.rect.area() > b.rect.area();
+            ncnn::Extractor ex = create_extractor(yolo11, *ctx);
+
+            ex.input("in0", tile_in);
+
+            for (size_t i = 0; i < local_cut_blobs.size() && incremental; i++)
+            {
+                ncnn::Mat feature;
+                ex.extract(local_cut_blobs[i].c_str(), feature);
+
+                ncnn::Mat& cached_feature = cache.features[i];
+
+                // every stride divides the 32 aligned tile, anything else is not a plain downscale
+                const int stride = feature.w > 0 ? (tx1 - tx0) / feature.w : 0;
+                if (stride == 0 || feature.w * stride != tx1 - tx0 || feature.h * stride != ty1 - ty0 || feature.c != cached_feature.c || cached_feature.w * stride != w)
+                {
+                    incremental = false;
+                    break;
+                }
+
+                const int margin = local_cut_radii[i];
+
+                // the core and the ring around it whose receptive field reaches the change, minus the edge margin
+                // tile edges on the frame edge are padded like the whole frame, stride aligned inward
+                const int sx0 = std::min(tx0 == 0 ? 0 : (tx0 + margin + stride - 1) / stride * stride, cx0);
+                const int sy0 = std::min(ty0 == 0 ? 0 : (ty0 + margin + stride - 1) / stride * stride, cy0);
+                const int sx1 = std::max(tx1 == w ? w : (tx1 - margin) / stride * stride, cx1);
+                const int sy1 = std::max(ty1 == h ? h : (ty1 - margin) / stride * stride, cy1);
+
+                copy_window(feature, (sx0 - tx0) / stride, (sy0 - ty0) / stride, cached_feature, sx0 / stride, sy0 / stride, (sx1 - sx0) / stride, (sy1 - sy0) / stride);
+            }
         }
-    } objects_area_greater;
-    std::sort(objects.begin(), objects.end(), objects_area_greater);
+
+        // the global tail on the spliced features, ncnn copies an input blob before working in place on it
+        if (incremental)
+        {
+            ncnn::Extractor ex = create_extractor(yolo11, *ctx);
+
+            for (size_t i = 0; i < local_cut_blobs.size(); i++)
+            {
+                ex.input(local_cut_blobs[i].c_str(), cache.features[i]);
+            }
+
+            ex.extract("out0", out);
+
+            copy_window(in_pad, cx0, cy0, cache.last_in, cx0, cy0, cx1 - cx0, cy1 - cy0);
+
+            cache.incremental_frames++;
+            cache.coverage_sum += coverage;
+            cache.since_parity++;
+        }
+    }
+
+    if (incremental && cache.parity_interval > 0 && cache.since_parity >= cache.parity_interval)
+    {
+        // measure the drift against a whole pass, then resync from it
+        std::vector<ncnn::Mat> features;
+        ncnn::Mat full_out;
+        forward_full(yolo11, in_pad, local_cut_blobs, features, full_out, *ctx);
+
+        float max_diff = 0.f;
+        for (int i = 0; i < out.h; i++)
+        {
+            const float* p0 = out.row(i);
+            const float* p1 = full_out.row(i);
+            for (int j = 0; j < out.w; j++)
+            {
+                max_diff = std::max(max_diff, fabsf(p0[j] - p1[j]));
+            }
+        }
+
+        std::vector<Object> incremental_objects;
+        decode_objects(out, lb, frame_prob_threshold, frame_max_candidates, get_decode_threads(*ctx), *ctx, incremental_objects);
+        decode_objects(full_out, lb, frame_prob_threshold, frame_max_candidates, get_decode_threads(*ctx), *ctx, objects);
+
+        cache.parity_checks++;
+        cache.parity_max_diff = std::max(cache.parity_max_diff, max_diff);
+        if (!similar_objects(incremental_objects, objects))
+            cache.parity_mismatches++;
+
+        cache.features = features;
+        cache.last_in = in_pad.clone();
+        cache.since_parity = 0;
+    }
+    else if (incremental)
+    {
+        decode_objects(out, lb, frame_prob_threshold, frame_max_candidates, get_decode_threads(*ctx), *ctx, objects);
+    }
+    else
+    {
+        forward_full(yolo11, in_pad, local_cut_blobs, cache.features, out, *ctx);
+
+        decode_objects(out, lb, frame_prob_threshold, frame_max_candidates, get_decode_threads(*ctx), *ctx, objects);
+
+        cache.owner = this;
+        cache.last_in = in_pad.clone();
+        cache.since_parity = 0;
+        cache.full_frames++;
+    }
+
+    remap_labels(objects);
+
+    cache.last_objects = objects;
+
+    release_context(ctx);
 
     return 0;
 }
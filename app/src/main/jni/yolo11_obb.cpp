@@ -108,8 +108,8 @@
 //
 
 #include "yolo11.h"
-
-#include "layer.h"
+#include "yolo11dfl.h"
+#include "yolo11scan.h"
 
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
@@ -118,17 +118,22 @@
 #include <stdio.h>
 #include <vector>
 
-static inline float intersection_area(const Object& a, const Object& b)
+static inline cv::RotatedRect rotated_rect(const Detection& d)
+{
+    return cv::RotatedRect(cv::Point2f((d.x0 + d.x1) * 0.5f, (d.y0 + d.y1) * 0.5f), cv::Size2f(d.x1 - d.x0, d.y1 - d.y0), d.angle);
+}
+
+static inline float intersection_area(const Detection& a, const Detection& b)
 {
     std::vector<cv::Point2f> intersection;
-    cv::rotatedRectangleIntersection(a.rrect, b.rrect, intersection);
+    cv::rotatedRectangleIntersection(rotated_rect(a), rotated_rect(b), intersection);
     if (intersection.empty())
         return 0.f;
 
     return cv::contourArea(intersection);
 }
 
-static void qsort_descent_inplace(std::vector<Object>& objects, int left, int right)
+static void qsort_descent_inplace(std::vector<Detection>& objects, int left, int right)
 {
     int i = left;
     int j = right;
@@ -165,7 +170,7 @@ static void qsort_descent_inplace(std::vector<Object>& objects, int left, int ri
     }
 }
 
-static void qsort_descent_inplace(std::vector<Object>& objects)
+static void qsort_descent_inplace(std::vector<Detection>& objects)
 {
     if (objects.empty())
         return;
@@ -173,7 +178,7 @@ static void qsort_descent_inplace(std::vector<Object>& objects)
     qsort_descent_inplace(objects, 0, objects.size() - 1);
 }
 
-static void nms_sorted_bboxes(const std::vector<Object>& objects, std::vector<int>& picked, float nms_threshold, bool agnostic = false)
+static void nms_sorted_bboxes(const std::vector<Detection>& objects, std::vector<int>& picked, float nms_threshold, bool agnostic = false)
 {
     picked.clear();
 
@@ -182,17 +187,17 @@ static void nms_sorted_bboxes(const std::vector<Object>& objects, std::vector<in
     std::vector<float> areas(n);
     for (int i = 0; i < n; i++)
     {
-        areas[i] = objects[i].rrect.size.area();
+        areas[i] = (objects[i].x1 - objects[i].x0) * (objects[i].y1 - objects[i].y0);
     }
 
     for (int i = 0; i < n; i++)
     {
-        const Object& a = objects[i];
+        const Detection& a = objects[i];
 
         int keep = 1;
         for (int j = 0; j < (int)picked.size(); j++)
         {
-            const Object& b = objects[picked[j]];
+            const Detection& b = objects[picked[j]];
 
             if (!agnostic && a.label != b.label)
                 continue;
@@ -215,84 +220,43 @@ static inline float sigmoid(float x)
     return 1.0f / (1.0f + expf(-x));
 }
 
-static void generate_proposals(const ncnn::Mat& pred, const ncnn::Mat& pred_angle, int stride, const ncnn::Mat& in_pad, float prob_threshold, std::vector<Object>& objects)
+static void generate_proposals(const ncnn::Mat& pred, const ncnn::Mat& pred_angle, const ProposalBand& band, const ncnn::Mat& in_pad, float score_threshold, std::vector<Detection>& objects)
 {
     const int w = in_pad.w;
-    const int h = in_pad.h;
 
+    const int stride = band.stride;
+    const int pred_row_offset = band.row_offset;
     const int num_grid_x = w / stride;
-    const int num_grid_y = h / stride;
 
     const int reg_max_1 = 16;
     const int num_class = pred.w - reg_max_1 * 4; // number of classes. 15 for DOTAv1
 
-    for (int y = 0; y < num_grid_y; y++)
+    for (int y = band.y0; y < band.y1; y++)
     {
         for (int x = 0; x < num_grid_x; x++)
         {
-            const ncnn::Mat pred_grid = pred.row_range(y * num_grid_x + x, 1);
-
-            // find label with max score
-            int label = -1;
-            float score = -FLT_MAX;
-            {
-                const ncnn::Mat pred_score = pred_grid.range(reg_max_1 * 4, num_class);
-
-                for (int k = 0; k < num_class; k++)
-                {
-                    float s = pred_score[k];
-                    if (s > score)
-                    {
-                        label = k;
-                        score = s;
-                    }
-                }
+            const float* pred_grid = pred.row(pred_row_offset + y * num_grid_x + x);
 
-                score = sigmoid(score);
-            }
+            // find label with max score, compared as a logit
+            const float* pred_score = pred_grid + reg_max_1 * 4;
+            float score = max_score(pred_score, num_class);
 
-            if (score >= prob_threshold)
+            if (score >= score_threshold)
             {
-                ncnn::Mat pred_bbox = pred_grid.range(0, reg_max_1 * 4).reshape(reg_max_1, 4).clone();
-
-                {
-                    ncnn::Layer* softmax = ncnn::create_layer("Softmax");
-
-                    ncnn::ParamDict pd;
-                    pd.set(0, 1); // axis
-                    pd.set(1, 1);
-                    softmax->load_param(pd);
-
-                    ncnn::Option opt;
-                    opt.num_threads = 1;
-                    opt.use_packing_layout = false;
-
-                    softmax->create_pipeline(opt);
-
-                    softmax->forward_inplace(pred_bbox, opt);
-
-                    softmax->destroy_pipeline(opt);
-
-                    delete softmax;
-                }
+                const int label = find_score(pred_score, num_class, score);
+                score = sigmoid(score);
 
                 float pred_ltrb[4];
+                dfl_decode(pred_grid, reg_max_1, pred_ltrb);
                 for (int k = 0; k < 4; k++)
                 {
-                    float dis = 0.f;
-                    const float* dis_after_sm = pred_bbox.row(k);
-                    for (int l = 0; l < reg_max_1; l++)
-                    {
-                        dis += l * dis_after_sm[l];
-                    }
-
-                    pred_ltrb[k] = dis * stride;
+                    pred_ltrb[k] *= stride;
                 }
 
                 float pb_cx = (x + 0.5f) * stride;
                 float pb_cy = (y + 0.5f) * stride;
 
-                const float angle = sigmoid(pred_angle.row(y * num_grid_x + x)[0]) - 0.25f;
+                const float angle = sigmoid(pred_angle.row(pred_row_offset + y * num_grid_x + x)[0]) - 0.25f;
 
                 const float angle_rad = angle * 3.14159265358979323846f;
                 const float angle_degree = angle * 180.f;
@@ -309,82 +273,74 @@ static void generate_proposals(const ncnn::Mat& pred, const ncnn::Mat& pred_angl
                 const float ww = pred_ltrb[2] + pred_ltrb[0];
                 const float hh = pred_ltrb[3] + pred_ltrb[1];
 
-                Object obj;
-                obj.rrect = cv::RotatedRect(cv::Point2f(cx, cy), cv::Size_<float>(ww, hh), angle_degree);
-                obj.label = label;
-                obj.prob = score;
-
-                objects.push_back(obj);
+                // the box before turning, see rotated_rect
+                Detection det;
+                det.x0 = cx - ww * 0.5f;
+                det.y0 = cy - hh * 0.5f;
+                det.x1 = cx + ww * 0.5f;
+                det.y1 = cy + hh * 0.5f;
+                det.angle = angle_degree;
+                det.prob = score;
+                det.label = label;
+                det.gindex = pred_row_offset + y * num_grid_x + x;
+
+                objects.push_back(det);
             }
         }
     }
 }
 
-static void generate_proposals(const ncnn::Mat& pred, const ncnn::Mat& pred_angle, const std::vector<int>& strides, const ncnn::Mat& in_pad, float prob_threshold, std::vector<Object>& objects)
+static void generate_proposals(const ncnn::Mat& pred, const ncnn::Mat& pred_angle, const std::vector<int>& strides, const ncnn::Mat& in_pad, float prob_threshold, int num_threads, std::vector<std::vector<Detection> >& band_objects, std::vector<Detection>& objects)
 {
-    const int w = in_pad.w;
-    const int h = in_pad.h;
+    const float score_threshold = prob_to_logit(prob_threshold);
 
-    int pred_row_offset = 0;
-    for (size_t i = 0; i < strides.size(); i++)
-    {
-        const int stride = strides[i];
+    std::vector<ProposalBand> bands;
+    plan_proposal_bands(in_pad.w, in_pad.h, strides, num_threads, bands);
 
-        const int num_grid_x = w / stride;
-        const int num_grid_y = h / stride;
-        const int num_grid = num_grid_x * num_grid_y;
+    const int band_count = (int)bands.size();
+    if ((int)band_objects.size() < band_count)
+        band_objects.resize(band_count);
 
-        generate_proposals(pred.row_range(pred_row_offset, num_grid), pred_angle.row_range(pred_row_offset, num_grid), stride, in_pad, prob_threshold, objects);
+    // every band fills its own list, nothing is shared between threads
+    #pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+    for (int i = 0; i < band_count; i++)
+    {
+        band_objects[i].clear();
+        generate_proposals(pred, pred_angle, bands[i], in_pad, score_threshold, band_objects[i]);
+    }
 
-        pred_row_offset += num_grid;
+    // joined in band order, the proposals come out as a single thread would find them
+    for (int i = 0; i < band_count; i++)
+    {
+        objects.insert(objects.end(), band_objects[i].begin(), band_objects[i].end());
     }
 }
 
-int YOLO11_obb::detect(const cv::Mat& rgb, std::vector<Object>& objects)
+int YOLO11_obb::detect(const Letterbox& lb, std::vector<Object>& objects, YOLO11Context& ctx)
 {
-    const int target_size = det_target_size;//1024;
     const float prob_threshold = 0.25f;
     const float nms_threshold = 0.45f;
 
-    int img_w = rgb.cols;
-    int img_h = rgb.rows;
+    const int img_w = lb.img_w;
+    const int img_h = lb.img_h;
 
     // ultralytics/cfg/models/v8/yolo11.yaml
     std::vector<int> strides(3);
     strides[0] = 8;
     strides[1] = 16;
     strides[2] = 32;
-    const int max_stride = 32;
 
-    // letterbox pad to multiple of max_stride
-    int w = img_w;
-    int h = img_h;
-    float scale = 1.f;
-    if (w > h)
-    {
-        scale = (float)target_size / w;
-        w = target_size;
-        h = h * scale;
-    }
-    else
-    {
-        scale = (float)target_size / h;
-        h = target_size;
-        w = w * scale;
-    }
-
-    ncnn::Mat in = ncnn::Mat::from_pixels_resize(rgb.data, ncnn::Mat::PIXEL_RGB, img_w, img_h, w, h);
-
-    // letterbox pad to target_size rectangle
-    int wpad = (w + max_stride - 1) / max_stride * max_stride - w;
-    int hpad = (h + max_stride - 1) / max_stride * max_stride - h;
-    ncnn::Mat in_pad;
-    ncnn::copy_make_border(in, in_pad, hpad / 2, hpad - hpad / 2, wpad / 2, wpad - wpad / 2, ncnn::BORDER_CONSTANT, 114.f);
-
-    const float norm_vals[3] = {1 / 255.f, 1 / 255.f, 1 / 255.f};
-    in_pad.substract_mean_normalize(0, norm_vals);
+    // letterboxed and normalized once per frame, possibly shared with other models
+    const ncnn::Mat& in_pad = lb.in_pad;
+    const float scale = lb.scale;
+    const int wpad = lb.wpad;
+    const int hpad = lb.hpad;
 
     ncnn::Extractor ex = yolo11.create_extractor();
+    ex.set_blob_allocator(&ctx.blob_allocator);
+    ex.set_workspace_allocator(&ctx.workspace_allocator);
+    if (ctx.num_threads > 0)
+        ex.set_num_threads(ctx.num_threads);
 
     ex.input("in0", in_pad);
 
@@ -394,8 +350,8 @@ int YOLO11_obb::detect(const cv::Mat& rgb, std::vector<Object>& objects)
     ncnn::Mat out_angle;
     ex.extract("out1", out_angle);
 
-    std::vector<Object> proposals;
-    generate_proposals(out, out_angle, strides, in_pad, prob_threshold, proposals);
+    std::vector<Detection> proposals;
+    generate_proposals(out, out_angle, strides, in_pad, prob_threshold, get_decode_threads(ctx), ctx.band_proposals, proposals);
 
     // sort all proposals by score from highest to lowest
     qsort_descent_inplace(proposals);
@@ -411,7 +367,13 @@ int YOLO11_obb::detect(const cv::Mat& rgb, std::vector<Object>& objects)
     objects.resize(count);
     for (int i = 0; i < count; i++)
     {
-        Object obj = proposals[picked[i]];
+        const Detection& det = proposals[picked[i]];
+
+        Object obj;
+        obj.rrect = rotated_rect(det);
+        obj.label = det.label;
+        obj.prob = det.prob;
+        obj.gindex = det.gindex;
 
         // adjust offset to original unpadded
         obj.rrect.center.x = (obj.rrect.center.x - (wpad / 2)) / scale;
@@ -422,6 +384,8 @@ int YOLO11_obb::detect(const cv::Mat& rgb, std::vector<Object>& objects)
         objects[i] = obj;
     }
 
+    remap_labels(objects);
+
     return 0;
 }
 
@@ -107,8 +107,8 @@
 //
 
 #include "yolo11.h"
-
-#include "layer.h"
+#include "yolo11dfl.h"
+#include "yolo11scan.h"
 
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
@@ -117,157 +117,40 @@
 #include <stdio.h>
 #include <vector>
 
-static inline float intersection_area(const Object& a, const Object& b)
-{
-    cv::Rect_<float> inter = a.rect & b.rect;
-    return inter.area();
-}
-
-static void qsort_descent_inplace(std::vector<Object>& objects, int left, int right)
-{
-    int i = left;
-    int j = right;
-    float p = objects[(left + right) / 2].prob;
-
-    while (i <= j)
-    {
-        while (objects[i].prob > p)
-            i++;
-
-        while (objects[j].prob < p)
-            j--;
-
-        if (i <= j)
-        {
-            // swap
-            std::swap(objects[i], objects[j]);
-
-            i++;
-            j--;
-        }
-    }
-
-    // #pragma omp parallel sections
-    {
-        // #pragma omp section
-        {
-            if (left < j) qsort_descent_inplace(objects, left, j);
-        }
-        // #pragma omp section
-        {
-            if (i < right) qsort_descent_inplace(objects, i, right);
-        }
-    }
-}
-
-static void qsort_descent_inplace(std::vector<Object>& objects)
-{
-    if (objects.empty())
-        return;
-
-    qsort_descent_inplace(objects, 0, objects.size() - 1);
-}
-
-static void nms_sorted_bboxes(const std::vector<Object>& objects, std::vector<int>& picked, float nms_threshold, bool agnostic = false)
-{
-    picked.clear();
-
-    const int n = objects.size();
-
-    std::vector<float> areas(n);
-    for (int i = 0; i < n; i++)
-    {
-        areas[i] = objects[i].rect.area();
-    }
-
-    for (int i = 0; i < n; i++)
-    {
-        const Object& a = objects[i];
-
-        int keep = 1;
-        for (int j = 0; j < (int)picked.size(); j++)
-        {
-            const Object& b = objects[picked[j]];
-
-            if (!agnostic && a.label != b.label)
-                continue;
-
-            // intersection over union
-            float inter_area = intersection_area(a, b);
-            float union_area = areas[i] + areas[picked[j]] - inter_area;
-            // float IoU = inter_area / union_area
-            if (inter_area / union_area > nms_threshold)
-                keep = 0;
-        }
-
-        if (keep)
-            picked.push_back(i);
-    }
-}
-
 static inline float sigmoid(float x)
 {
     return 1.0f / (1.0f + expf(-x));
 }
 
-static void generate_proposals(const ncnn::Mat& pred, const ncnn::Mat& pred_points, int stride, const ncnn::Mat& in_pad, float prob_threshold, std::vector<Object>& objects)
+static void generate_proposals(const ncnn::Mat& pred, const ncnn::Mat& pred_points, const ProposalBand& band, const ncnn::Mat& in_pad, float score_threshold, std::vector<Detection>& objects)
 {
     const int w = in_pad.w;
-    const int h = in_pad.h;
 
+    const int stride = band.stride;
+    const int pred_row_offset = band.row_offset;
     const int num_grid_x = w / stride;
-    const int num_grid_y = h / stride;
 
     const int reg_max_1 = 16;
-    const int num_points = pred_points.w / 3;
 
-    for (int y = 0; y < num_grid_y; y++)
+    for (int y = band.y0; y < band.y1; y++)
     {
         for (int x = 0; x < num_grid_x; x++)
         {
-            const ncnn::Mat pred_grid = pred.row_range(y * num_grid_x + x, 1);
-            const ncnn::Mat pred_points_grid = pred_points.row_range(y * num_grid_x + x, 1).reshape(3, num_points);
+            const float* pred_grid = pred.row(pred_row_offset + y * num_grid_x + x);
 
-            // find label with max score
+            // single class, compared as a logit
             int label = 0;
-            float score = sigmoid(pred_grid[reg_max_1 * 4]);
+            float score = pred_grid[reg_max_1 * 4];
 
-            if (score >= prob_threshold)
+            if (score >= score_threshold)
             {
-                ncnn::Mat pred_bbox = pred_grid.range(0, reg_max_1 * 4).reshape(reg_max_1, 4).clone();
-
-                {
-                    ncnn::Layer* softmax = ncnn::create_layer("Softmax");
-
-                    ncnn::ParamDict pd;
-                    pd.set(0, 1); // axis
-                    pd.set(1, 1);
-                    softmax->load_param(pd);
-
-                    ncnn::Option opt;
-                    opt.num_threads = 1;
-                    opt.use_packing_layout = false;
-
-                    softmax->create_pipeline(opt);
-
-                    softmax->forward_inplace(pred_bbox, opt);
-
-                    softmax->destroy_pipeline(opt);
-
-                    delete softmax;
-                }
+                score = sigmoid(score);
 
                 float pred_ltrb[4];
+                dfl_decode(pred_grid, reg_max_1, pred_ltrb);
                 for (int k = 0; k < 4; k++)
                 {
-                    float dis = 0.f;
-                    const float* dis_after_sm = pred_bbox.row(k);
-                    for (int l = 0; l < reg_max_1; l++)
-                    {
-                        dis += l * dis_after_sm[l];
-                    }
-
-                    pred_ltrb[k] = dis * stride;
+                    pred_ltrb[k] *= stride;
                 }
 
                 float pb_cx = (x + 0.5f) * stride;
@@ -278,97 +161,113 @@ static void generate_proposals(const ncnn::Mat& pred, const ncnn::Mat& pred_poin
                 float x1 = pb_cx + pred_ltrb[2];
                 float y1 = pb_cy + pred_ltrb[3];
 
-                std::vector<KeyPoint> keypoints;
-                for (int k = 0; k < num_points; k++)
-                {
-                    KeyPoint keypoint;
-                    keypoint.p.x = (x + pred_points_grid.row(k)[0] * 2) * stride;
-                    keypoint.p.y = (y + pred_points_grid.row(k)[1] * 2) * stride;
-                    keypoint.prob = sigmoid(pred_points_grid.row(k)[2]);
-                    keypoints.push_back(keypoint);
-                }
-
-                Object obj;
-                obj.rect.x = x0;
-                obj.rect.y = y0;
-                obj.rect.width = x1 - x0;
-                obj.rect.height = y1 - y0;
-                obj.label = label;
-                obj.prob = score;
-                obj.keypoints = keypoints;
-
-                objects.push_back(obj);
+                Detection det;
+                det.x0 = x0;
+                det.y0 = y0;
+                det.x1 = x1;
+                det.y1 = y1;
+                det.angle = 0.f;
+                det.prob = score;
+                det.label = label;
+                det.gindex = pred_row_offset + y * num_grid_x + x;
+
+                objects.push_back(det);
             }
         }
     }
 }
 
-static void generate_proposals(const ncnn::Mat& pred, const ncnn::Mat& pred_points, const std::vector<int>& strides, const ncnn::Mat& in_pad, float prob_threshold, std::vector<Object>& objects)
+static void generate_proposals(const ncnn::Mat& pred, const ncnn::Mat& pred_points, const std::vector<int>& strides, const ncnn::Mat& in_pad, float prob_threshold, int num_threads, std::vector<std::vector<Detection> >& band_objects, std::vector<Detection>& objects)
+{
+    const float score_threshold = prob_to_logit(prob_threshold);
+
+    std::vector<ProposalBand> bands;
+    plan_proposal_bands(in_pad.w, in_pad.h, strides, num_threads, bands);
+
+    const int band_count = (int)bands.size();
+    if ((int)band_objects.size() < band_count)
+        band_objects.resize(band_count);
+
+    // every band fills its own list, nothing is shared between threads
+    #pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+    for (int i = 0; i < band_count; i++)
+    {
+        band_objects[i].clear();
+        generate_proposals(pred, pred_points, bands[i], in_pad, score_threshold, band_objects[i]);
+    }
+
+    // joined in band order, the proposals come out as a single thread would find them
+    for (int i = 0; i < band_count; i++)
+    {
+        objects.insert(objects.end(), band_objects[i].begin(), band_objects[i].end());
+    }
+}
+
+// keypoints of the anchor at head row gindex in letterbox pixels, only decoded for the proposals nms keeps
+static void decode_keypoints(const ncnn::Mat& pred_points, int gindex, const std::vector<int>& strides, const ncnn::Mat& in_pad, std::vector<KeyPoint>& keypoints)
 {
     const int w = in_pad.w;
     const int h = in_pad.h;
 
-    int pred_row_offset = 0;
+    // level and grid cell of the anchor
+    int index = gindex;
+    int stride = strides[0];
     for (size_t i = 0; i < strides.size(); i++)
     {
-        const int stride = strides[i];
+        stride = strides[i];
 
-        const int num_grid_x = w / stride;
-        const int num_grid_y = h / stride;
-        const int num_grid = num_grid_x * num_grid_y;
+        const int num_grid = (w / stride) * (h / stride);
+        if (index < num_grid)
+            break;
 
-        generate_proposals(pred.row_range(pred_row_offset, num_grid), pred_points.row_range(pred_row_offset, num_grid), stride, in_pad, prob_threshold, objects);
+        index -= num_grid;
+    }
+
+    const int num_grid_x = w / stride;
+    const int x = index % num_grid_x;
+    const int y = index / num_grid_x;
 
-        pred_row_offset += num_grid;
+    // x y visibility per keypoint
+    const float* pred_points_grid = pred_points.row(gindex);
+    const int num_points = pred_points.w / 3;
+
+    keypoints.resize(num_points);
+    for (int k = 0; k < num_points; k++)
+    {
+        keypoints[k].p.x = (x + pred_points_grid[k * 3] * 2) * stride;
+        keypoints[k].p.y = (y + pred_points_grid[k * 3 + 1] * 2) * stride;
+        keypoints[k].prob = sigmoid(pred_points_grid[k * 3 + 2]);
     }
 }
 
-int YOLO11_pose::detect(const cv::Mat& rgb, std::vector<Object>& objects)
+int YOLO11_pose::detect(const Letterbox& lb, std::vector<Object>& objects, YOLO11Context& ctx)
 {
-    const int target_size = det_target_size;//640;
     const float prob_threshold = 0.25f;
     const float nms_threshold = 0.45f;
+    const int max_candidates = 1000;
+    const int max_det = 300;
     const float mask_threshold = 0.5f;
 
-    int img_w = rgb.cols;
-    int img_h = rgb.rows;
+    const int img_w = lb.img_w;
+    const int img_h = lb.img_h;
 
     // ultralytics/cfg/models/v8/yolo11.yaml
     std::vector<int> strides(3);
     strides[0] = 8;
     strides[1] = 16;
     strides[2] = 32;
-    const int max_stride = 32;
 
-    // letterbox pad to multiple of max_stride
-    int w = img_w;
-    int h = img_h;
-    float scale = 1.f;
-    if (w > h)
-    {
-        scale = (float)target_size / w;
-        w = target_size;
-        h = h * scale;
-    }
-    else
-    {
-        scale = (float)target_size / h;
-        h = target_size;
-        w = w * scale;
-    }
-
-    ncnn::Mat in = ncnn::Mat::from_pixels_resize(rgb.data, ncnn::Mat::PIXEL_RGB, img_w, img_h, w, h);
-
-    // letterbox pad to target_size rectangle
-    int wpad = (w + max_stride - 1) / max_stride * max_stride - w;
-    int hpad = (h + max_stride - 1) / max_stride * max_stride - h;
-    ncnn::Mat in_pad;
-    ncnn::copy_make_border(in, in_pad, hpad / 2, hpad - hpad / 2, wpad / 2, wpad - wpad / 2, ncnn::BORDER_CONSTANT, 114.f);
-
-    const float norm_vals[3] = {1 / 255.f, 1 / 255.f, 1 / 255.f};
-    in_pad.substract_mean_normalize(0, norm_vals);
+    // letterboxed and normalized once per frame, possibly shared with other models
+    const ncnn::Mat& in_pad = lb.in_pad;
+    const float scale = lb.scale;
+    const int wpad = lb.wpad;
+    const int hpad = lb.hpad;
 
     ncnn::Extractor ex = yolo11.create_extractor();
+    ex.set_blob_allocator(&ctx.blob_allocator);
+    ex.set_workspace_allocator(&ctx.workspace_allocator);
+    if (ctx.num_threads > 0)
+        ex.set_num_threads(ctx.num_threads);
 
     ex.input("in0", in_pad);
 
@@ -378,17 +277,17 @@ int YOLO11_pose::detect(const cv::Mat& rgb, std::vector<Object>& objects)
     ncnn::Mat out_points;
     ex.extract("out1", out_points);
 
-    std::vector<Object> proposals;
-    generate_proposals(out, out_points, strides, in_pad, prob_threshold, proposals);
+    std::vector<Detection> proposals;
+    generate_proposals(out, out_points, strides, in_pad, prob_threshold, get_decode_threads(ctx), ctx.band_proposals, proposals);
 
-    // sort all proposals by score from highest to lowest
-    qsort_descent_inplace(proposals);
-
-    // apply nms with nms_threshold
+    // apply nms with nms_threshold to the max_candidates highest scores, keeping at most max_det
     std::vector<int> picked;
-    nms_sorted_bboxes(proposals, picked, nms_threshold);
+    nms_detections(proposals, picked, nms_threshold, max_candidates, max_det, false, ctx.nms_workspace);
 
     int count = picked.size();
+
+    // fresh objects, the caller's vector may hold a previous frame
+    objects.clear();
     if (count == 0)
         return 0;
 
@@ -397,13 +296,19 @@ int YOLO11_pose::detect(const cv::Mat& rgb, std::vector<Object>& objects)
     objects.resize(count);
     for (int i = 0; i < count; i++)
     {
-        objects[i] = proposals[picked[i]];
+        const Detection& det = proposals[picked[i]];
+
+        objects[i].label = det.label;
+        objects[i].prob = det.prob;
+        objects[i].gindex = det.gindex;
+
+        decode_keypoints(out_points, det.gindex, strides, in_pad, objects[i].keypoints);
 
         // adjust offset to original unpadded
-        float x0 = (objects[i].rect.x - (wpad / 2)) / scale;
-        float y0 = (objects[i].rect.y - (hpad / 2)) / scale;
-        float x1 = (objects[i].rect.x + objects[i].rect.width - (wpad / 2)) / scale;
-        float y1 = (objects[i].rect.y + objects[i].rect.height - (hpad / 2)) / scale;
+        float x0 = (det.x0 - (wpad / 2)) / scale;
+        float y0 = (det.y0 - (hpad / 2)) / scale;
+        float x1 = (det.x1 - (wpad / 2)) / scale;
+        float y1 = (det.y1 - (hpad / 2)) / scale;
 
         for (int j = 0; j < num_points; j++)
         {
@@ -433,6 +338,8 @@ int YOLO11_pose::detect(const cv::Mat& rgb, std::vector<Object>& objects)
     } objects_area_greater;
     std::sort(objects.begin(), objects.end(), objects_area_greater);
 
+    remap_labels(objects);
+
     return 0;
 }
 
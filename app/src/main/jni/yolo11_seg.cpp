@@ -109,6 +109,8 @@
 //
 
 #include "yolo11.h"
+#include "yolo11dfl.h"
+#include "yolo11scan.h"
 
 #include "layer.h"
 
@@ -119,171 +121,42 @@
 #include <stdio.h>
 #include <vector>
 
-static inline float intersection_area(const Object& a, const Object& b)
-{
-    cv::Rect_<float> inter = a.rect & b.rect;
-    return inter.area();
-}
-
-static void qsort_descent_inplace(std::vector<Object>& objects, int left, int right)
-{
-    int i = left;
-    int j = right;
-    float p = objects[(left + right) / 2].prob;
-
-    while (i <= j)
-    {
-        while (objects[i].prob > p)
-            i++;
-
-        while (objects[j].prob < p)
-            j--;
-
-        if (i <= j)
-        {
-            // swap
-            std::swap(objects[i], objects[j]);
-
-            i++;
-            j--;
-        }
-    }
-
-    // #pragma omp parallel sections
-    {
-        // #pragma omp section
-        {
-            if (left < j) qsort_descent_inplace(objects, left, j);
-        }
-        // #pragma omp section
-        {
-            if (i < right) qsort_descent_inplace(objects, i, right);
-        }
-    }
-}
-
-static void qsort_descent_inplace(std::vector<Object>& objects)
-{
-    if (objects.empty())
-        return;
-
-    qsort_descent_inplace(objects, 0, objects.size() - 1);
-}
-
-static void nms_sorted_bboxes(const std::vector<Object>& objects, std::vector<int>& picked, float nms_threshold, bool agnostic = false)
-{
-    picked.clear();
-
-    const int n = objects.size();
-
-    std::vector<float> areas(n);
-    for (int i = 0; i < n; i++)
-    {
-        areas[i] = objects[i].rect.area();
-    }
-
-    for (int i = 0; i < n; i++)
-    {
-        const Object& a = objects[i];
-
-        int keep = 1;
-        for (int j = 0; j < (int)picked.size(); j++)
-        {
-            const Object& b = objects[picked[j]];
-
-            if (!agnostic && a.label != b.label)
-                continue;
-
-            // intersection over union
-            float inter_area = intersection_area(a, b);
-            float union_area = areas[i] + areas[picked[j]] - inter_area;
-            // float IoU = inter_area / union_area
-            if (inter_area / union_area > nms_threshold)
-                keep = 0;
-        }
-
-        if (keep)
-            picked.push_back(i);
-    }
-}
-
 static inline float sigmoid(float x)
 {
     return 1.0f / (1.0f + expf(-x));
 }
 
-static void generate_proposals(const ncnn::Mat& pred, int stride, const ncnn::Mat& in_pad, float prob_threshold, std::vector<Object>& objects)
+static void generate_proposals(const ncnn::Mat& pred, const ProposalBand& band, const ncnn::Mat& in_pad, float score_threshold, std::vector<Detection>& objects)
 {
     const int w = in_pad.w;
-    const int h = in_pad.h;
 
+    const int stride = band.stride;
+    const int pred_row_offset = band.row_offset;
     const int num_grid_x = w / stride;
-    const int num_grid_y = h / stride;
 
     const int reg_max_1 = 16;
     const int num_class = pred.w - reg_max_1 * 4; // number of classes. 80 for COCO
 
-    for (int y = 0; y < num_grid_y; y++)
+    for (int y = band.y0; y < band.y1; y++)
     {
         for (int x = 0; x < num_grid_x; x++)
         {
-            const ncnn::Mat pred_grid = pred.row_range(y * num_grid_x + x, 1);
-
-            // find label with max score
-            int label = -1;
-            float score = -FLT_MAX;
-            {
-                const ncnn::Mat pred_score = pred_grid.range(reg_max_1 * 4, num_class);
+            const float* pred_grid = pred.row(pred_row_offset + y * num_grid_x + x);
 
-                for (int k = 0; k < num_class; k++)
-                {
-                    float s = pred_score[k];
-                    if (s > score)
-                    {
-                        label = k;
-                        score = s;
-                    }
-                }
-
-                score = sigmoid(score);
-            }
+            // find label with max score, compared as a logit
+            const float* pred_score = pred_grid + reg_max_1 * 4;
+            float score = max_score(pred_score, num_class);
 
-            if (score >= prob_threshold)
+            if (score >= score_threshold)
             {
-                ncnn::Mat pred_bbox = pred_grid.range(0, reg_max_1 * 4).reshape(reg_max_1, 4).clone();
-
-                {
-                    ncnn::Layer* softmax = ncnn::create_layer("Softmax");
-
-                    ncnn::ParamDict pd;
-                    pd.set(0, 1); // axis
-                    pd.set(1, 1);
-                    softmax->load_param(pd);
-
-                    ncnn::Option opt;
-                    opt.num_threads = 1;
-                    opt.use_packing_layout = false;
-
-                    softmax->create_pipeline(opt);
-
-                    softmax->forward_inplace(pred_bbox, opt);
-
-                    softmax->destroy_pipeline(opt);
-
-                    delete softmax;
-                }
+                const int label = find_score(pred_score, num_class, score);
+                score = sigmoid(score);
 
                 float pred_ltrb[4];
+                dfl_decode(pred_grid, reg_max_1, pred_ltrb);
                 for (int k = 0; k < 4; k++)
                 {
-                    float dis = 0.f;
-                    const float* dis_after_sm = pred_bbox.row(k);
-                    for (int l = 0; l < reg_max_1; l++)
-                    {
-                        dis += l * dis_after_sm[l];
-                    }
-
-                    pred_ltrb[k] = dis * stride;
+                    pred_ltrb[k] *= stride;
                 }
 
                 float pb_cx = (x + 0.5f) * stride;
@@ -294,112 +167,100 @@ static void generate_proposals(const ncnn::Mat& pred, int stride, const ncnn::Ma
                 float x1 = pb_cx + pred_ltrb[2];
                 float y1 = pb_cy + pred_ltrb[3];
 
-                Object obj;
-                obj.rect.x = x0;
-                obj.rect.y = y0;
-                obj.rect.width = x1 - x0;
-                obj.rect.height = y1 - y0;
-                obj.label = label;
-                obj.prob = score;
-                obj.gindex = y * num_grid_x + x;
-
-                objects.push_back(obj);
+                Detection det;
+                det.x0 = x0;
+                det.y0 = y0;
+                det.x1 = x1;
+                det.y1 = y1;
+                det.angle = 0.f;
+                det.prob = score;
+                det.label = label;
+                det.gindex = pred_row_offset + y * num_grid_x + x;
+
+                objects.push_back(det);
             }
         }
     }
 }
 
-static void generate_proposals(const ncnn::Mat& pred, const std::vector<int>& strides, const ncnn::Mat& in_pad, float prob_threshold, std::vector<Object>& objects)
+static void generate_proposals(const ncnn::Mat& pred, const std::vector<int>& strides, const ncnn::Mat& in_pad, float prob_threshold, int num_threads, std::vector<std::vector<Detection> >& band_objects, std::vector<Detection>& objects)
 {
-    const int w = in_pad.w;
-    const int h = in_pad.h;
-
-    int pred_row_offset = 0;
-    for (size_t i = 0; i < strides.size(); i++)
-    {
-        const int stride = strides[i];
+    const float score_threshold = prob_to_logit(prob_threshold);
 
-        const int num_grid_x = w / stride;
-        const int num_grid_y = h / stride;
-        const int num_grid = num_grid_x * num_grid_y;
+    std::vector<ProposalBand> bands;
+    plan_proposal_bands(in_pad.w, in_pad.h, strides, num_threads, bands);
 
-        std::vector<Object> objects_stride;
-        generate_proposals(pred.row_range(pred_row_offset, num_grid), stride, in_pad, prob_threshold, objects_stride);
+    const int band_count = (int)bands.size();
+    if ((int)band_objects.size() < band_count)
+        band_objects.resize(band_count);
 
-        for (size_t j = 0; j < objects_stride.size(); j++)
-        {
-            Object obj = objects_stride[j];
-            obj.gindex += pred_row_offset;
-            objects.push_back(obj);
-        }
+    // every band fills its own list, nothing is shared between threads
+    #pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+    for (int i = 0; i < band_count; i++)
+    {
+        band_objects[i].clear();
+        generate_proposals(pred, bands[i], in_pad, score_threshold, band_objects[i]);
+    }
 
-        pred_row_offset += num_grid;
+    // joined in band order, the proposals come out as a single thread would find them
+    for (int i = 0; i < band_count; i++)
+    {
+        objects.insert(objects.end(), band_objects[i].begin(), band_objects[i].end());
     }
 }
 
-int YOLO11_seg::detect(const cv::Mat& rgb, std::vector<Object>& objects)
+int YOLO11_seg::detect(const Letterbox& lb, std::vector<Object>& objects, YOLO11Context& ctx)
 {
-    const int target_size = det_target_size;//640;
     const float prob_threshold = 0.25f;
     const float nms_threshold = 0.45f;
+    const int max_candidates = 1000;
+    const int max_det = 300;
     const float mask_threshold = 0.5f;
 
-    int img_w = rgb.cols;
-    int img_h = rgb.rows;
+    const int img_w = lb.img_w;
+    const int img_h = lb.img_h;
 
     // ultralytics/cfg/models/v8/yolo11.yaml
     std::vector<int> strides(3);
     strides[0] = 8;
     strides[1] = 16;
     strides[2] = 32;
-    const int max_stride = 32;
 
-    // letterbox pad to multiple of max_stride
-    int w = img_w;
-    int h = img_h;
-    float scale = 1.f;
-    if (w > h)
-    {
-        scale = (float)target_size / w;
-        w = target_size;
-        h = h * scale;
-    }
-    else
-    {
-        scale = (float)target_size / h;
-        h = target_size;
-        w = w * scale;
-    }
-
-    ncnn::Mat in = ncnn::Mat::from_pixels_resize(rgb.data, ncnn::Mat::PIXEL_RGB, img_w, img_h, w, h);
+    // letterboxed and normalized once per frame, possibly shared with other models
+    const ncnn::Mat& in_pad = lb.in_pad;
+    const float scale = lb.scale;
+    const int wpad = lb.wpad;
+    const int hpad = lb.hpad;
 
-    // letterbox pad to target_size rectangle
-    int wpad = (w + max_stride - 1) / max_stride * max_stride - w;
-    int hpad = (h + max_stride - 1) / max_stride * max_stride - h;
-    ncnn::Mat in_pad;
-    ncnn::copy_make_border(in, in_pad, hpad / 2, hpad - hpad / 2, wpad / 2, wpad - wpad / 2, ncnn::BORDER_CONSTANT, 114.f);
-
-    const float norm_vals[3] = {1 / 255.f, 1 / 255.f, 1 / 255.f};
-    in_pad.substract_mean_normalize(0, norm_vals);
+    // post-processing Mats come from the same pools as the net blobs
+    ncnn::Option pool_opt;
+    pool_opt.blob_allocator = &ctx.blob_allocator;
+    pool_opt.workspace_allocator = &ctx.workspace_allocator;
+    if (ctx.num_threads > 0)
+        pool_opt.num_threads = ctx.num_threads;
 
     ncnn::Extractor ex = yolo11.create_extractor();
+    ex.set_blob_allocator(&ctx.blob_allocator);
+    ex.set_workspace_allocator(&ctx.workspace_allocator);
+    if (ctx.num_threads > 0)
+        ex.set_num_threads(ctx.num_threads);
 
     ex.input("in0", in_pad);
 
     ncnn::Mat out;
     ex.extract("out0", out);
 
-    std::vector<Object> proposals;
-    generate_proposals(out, strides, in_pad, prob_threshold, proposals);
-
-    // sort all proposals by score from highest to lowest
-    qsort_descent_inplace(proposals);
+    std::vector<Detection> proposals;
+    generate_proposals(out, strides, in_pad, prob_threshold, get_decode_threads(ctx), ctx.band_proposals, proposals);
 
-    // apply nms with nms_threshold
+    // apply nms with nms_threshold to the max_candidates highest scores, keeping at most max_det
     std::vector<int> picked;
-    nms_sorted_bboxes(proposals, picked, nms_threshold);
+    nms_detections(proposals, picked, nms_threshold, max_candidates, max_det, false, ctx.nms_workspace);
 
     int count = picked.size();
+
+    // fresh objects, the caller's vector may hold a previous frame
+    objects.clear();
     if (count == 0)
         return 0;
 
@@ -409,18 +270,18 @@ int YOLO11_seg::detect(const cv::Mat& rgb, std::vector<Object>& objects)
     ncnn::Mat mask_protos;
     ex.extract("out2", mask_protos);
 
-    ncnn::Mat objects_mask_feat(mask_feat.w, 1, count);
+    ncnn::Mat objects_mask_feat(mask_feat.w, 1, count, 4u, &ctx.blob_allocator);
 
     objects.resize(count);
     for (int i = 0; i < count; i++)
     {
-        objects[i] = proposals[picked[i]];
+        const Detection& det = proposals[picked[i]];
 
         // adjust offset to original unpadded
-        float x0 = (objects[i].rect.x - (wpad / 2)) / scale;
-        float y0 = (objects[i].rect.y - (hpad / 2)) / scale;
-        float x1 = (objects[i].rect.x + objects[i].rect.width - (wpad / 2)) / scale;
-        float y1 = (objects[i].rect.y + objects[i].rect.height - (hpad / 2)) / scale;
+        float x0 = (det.x0 - (wpad / 2)) / scale;
+        float y0 = (det.y0 - (hpad / 2)) / scale;
+        float x1 = (det.x1 - (wpad / 2)) / scale;
+        float y1 = (det.y1 - (hpad / 2)) / scale;
 
         // clip
         x0 = std::max(std::min(x0, (float)(img_w - 1)), 0.f);
@@ -432,6 +293,9 @@ int YOLO11_seg::detect(const cv::Mat& rgb, std::vector<Object>& objects)
         objects[i].rect.y = y0;
         objects[i].rect.width = x1 - x0;
         objects[i].rect.height = y1 - y0;
+        objects[i].label = det.label;
+        objects[i].prob = det.prob;
+        objects[i].gindex = det.gindex;
 
         // pick mask feat
         memcpy(objects_mask_feat.channel(i), mask_feat.row(objects[i].gindex), mask_feat.w * sizeof(float));
@@ -454,6 +318,8 @@ int YOLO11_seg::detect(const cv::Mat& rgb, std::vector<Object>& objects)
         ncnn::Option opt;
         opt.num_threads = 1;
         opt.use_packing_layout = false;
+        opt.blob_allocator = &ctx.blob_allocator;
+        opt.workspace_allocator = &ctx.workspace_allocator;
 
         gemm->create_pipeline(opt);
 
@@ -474,6 +340,8 @@ int YOLO11_seg::detect(const cv::Mat& rgb, std::vector<Object>& objects)
         ncnn::Option opt;
         opt.num_threads = 1;
         opt.use_packing_layout = false;
+        opt.blob_allocator = &ctx.blob_allocator;
+        opt.workspace_allocator = &ctx.workspace_allocator;
 
         sigmoid->create_pipeline(opt);
 
@@ -487,7 +355,7 @@ int YOLO11_seg::detect(const cv::Mat& rgb, std::vector<Object>& objects)
     // resize mask map
     {
         ncnn::Mat objects_mask_resized;
-        ncnn::resize_bilinear(objects_mask, objects_mask_resized, in_pad.w / scale, in_pad.h / scale);
+        ncnn::resize_bilinear(objects_mask, objects_mask_resized, in_pad.w / scale, in_pad.h / scale, pool_opt);
         objects_mask = objects_mask_resized;
     }
 
@@ -522,6 +390,8 @@ int YOLO11_seg::detect(const cv::Mat& rgb, std::vector<Object>& objects)
     } objects_area_greater;
     std::sort(objects.begin(), objects.end(), objects_area_greater);
 
+    remap_labels(objects);
+
     return 0;
 }
 
@@ -0,0 +1,191 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2025 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "yolo11async.h"
+
+#include <algorithm>
+
+#include <benchmark.h>
+
+YOLO11Async::YOLO11Async(const std::shared_ptr<YOLO11>& _yolo11, int worker_count, int _queue_capacity, Policy _policy)
+    : yolo11(_yolo11)
+{
+    queue_capacity = std::max(_queue_capacity, 1);
+    policy = _policy;
+    quit = false;
+
+    worker_count = std::max(worker_count, 1);
+    for (int i = 0; i < worker_count; i++)
+    {
+        workers.push_back(new ncnn::Thread(worker_entry, this));
+    }
+}
+
+YOLO11Async::~YOLO11Async()
+{
+    std::deque<Request> cancelled;
+
+    {
+        ncnn::MutexLockGuard g(lock);
+
+        quit = true;
+        cancelled.swap(queue);
+
+        not_empty.broadcast();
+        not_full.broadcast();
+    }
+
+    for (size_t i = 0; i < workers.size(); i++)
+    {
+        workers[i]->join();
+        delete workers[i];
+    }
+    workers.clear();
+
+    std::vector<Object> objects;
+    for (size_t i = 0; i < cancelled.size(); i++)
+    {
+        complete(cancelled[i], CANCELLED, objects);
+    }
+}
+
+void YOLO11Async::submit(const cv::Mat& rgb, const Callback& callback, float deadline_ms)
+{
+    Request request;
+    request.rgb = rgb;
+    request.callback = callback;
+    request.submit_time = ncnn::get_current_time();
+    request.deadline = deadline_ms > 0.f ? request.submit_time + deadline_ms : 0.0;
+
+    bool dropped = false;
+    bool cancelled = false;
+    Request oldest;
+
+    {
+        ncnn::MutexLockGuard g(lock);
+
+        if (policy == BLOCK)
+        {
+            while (!quit && (int)queue.size() >= queue_capacity)
+            {
+                not_full.wait(lock);
+            }
+        }
+
+        if (quit)
+        {
+            // shutting down, nobody will pick it up
+            cancelled = true;
+        }
+        else
+        {
+            if ((int)queue.size() >= queue_capacity)
+            {
+                oldest = queue.front();
+                queue.pop_front();
+                dropped = true;
+            }
+
+            queue.push_back(request);
+            not_empty.signal();
+        }
+    }
+
+    // callbacks run outside the lock, they may submit again
+    std::vector<Object> objects;
+    if (dropped)
+        complete(oldest, DROPPED, objects);
+    if (cancelled)
+        complete(request, CANCELLED, objects);
+}
+
+std::future<AsyncResult> YOLO11Async::submit(const cv::Mat& rgb, float deadline_ms)
+{
+    std::shared_ptr<std::promise<AsyncResult> > promise = std::make_shared<std::promise<AsyncResult> >();
+    std::future<AsyncResult> future = promise->get_future();
+
+    submit(rgb, [promise](AsyncResult& result) { promise->set_value(result); }, deadline_ms);
+
+    return future;
+}
+
+int YOLO11Async::pending() const
+{
+    ncnn::MutexLockGuard g(lock);
+
+    return (int)queue.size();
+}
+
+const std::shared_ptr<YOLO11>& YOLO11Async::get_model() const
+{
+    return yolo11;
+}
+
+void* YOLO11Async::worker_entry(void* args)
+{
+    ((YOLO11Async*)args)->run();
+
+    return 0;
+}
+
+void YOLO11Async::run()
+{
+    for (;;)
+    {
+        Request request;
+
+        {
+            ncnn::MutexLockGuard g(lock);
+
+            while (!quit && queue.empty())
+            {
+                not_empty.wait(lock);
+            }
+
+            if (quit)
+                break;
+
+            request = queue.front();
+            queue.pop_front();
+
+            not_full.signal();
+        }
+
+        std::vector<Object> objects;
+
+        if (request.deadline != 0.0 && ncnn::get_current_time() > request.deadline)
+        {
+            complete(request, EXPIRED, objects);
+            continue;
+        }
+
+        yolo11->detect(request.rgb, objects);
+
+        complete(request, OK, objects);
+    }
+}
+
+void YOLO11Async::complete(Request& request, int status, std::vector<Object>& objects)
+{
+    AsyncResult result;
+    result.status = status;
+    result.objects.swap(objects);
+    result.latency = (float)(ncnn::get_current_time() - request.submit_time);
+
+    // release the frame before handing control back
+    request.rgb.release();
+
+    if (request.callback)
+        request.callback(result);
+}
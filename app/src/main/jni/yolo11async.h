@@ -0,0 +1,97 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2025 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef YOLO11ASYNC_H
+#define YOLO11ASYNC_H
+
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include <platform.h>
+
+#include "yolo11.h"
+
+struct AsyncResult
+{
+    int status;
+    std::vector<Object> objects;
+    float latency; // milliseconds from submit to completion
+};
+
+// detect on worker threads behind a bounded request queue, the caller gets a callback or a future
+// each worker borrows its own context from the shared model
+class YOLO11Async
+{
+public:
+    enum
+    {
+        OK = 0,
+        DROPPED = -1,   // pushed out of a full queue by a newer request
+        EXPIRED = -2,   // deadline passed before a worker picked it up
+        CANCELLED = -3  // still queued when the async front-end was destroyed
+    };
+
+    enum Policy
+    {
+        DROP_OLDEST = 0, // a full queue completes its oldest request as DROPPED, live camera frames
+        BLOCK = 1        // submit waits for room, offline batches
+    };
+
+    // runs on a worker thread, or on the submitting thread for DROPPED
+    typedef std::function<void(AsyncResult& result)> Callback;
+
+    YOLO11Async(const std::shared_ptr<YOLO11>& yolo11, int worker_count = 1, int queue_capacity = 2, Policy policy = DROP_OLDEST);
+    ~YOLO11Async();
+
+    // rgb is shared, not copied, leave it untouched until completion or submit a clone
+    // deadline_ms is relative to now, 0 never expires
+    void submit(const cv::Mat& rgb, const Callback& callback, float deadline_ms = 0.f);
+    std::future<AsyncResult> submit(const cv::Mat& rgb, float deadline_ms = 0.f);
+
+    // requests waiting for a worker
+    int pending() const;
+
+    const std::shared_ptr<YOLO11>& get_model() const;
+
+private:
+    struct Request
+    {
+        cv::Mat rgb;
+        Callback callback;
+        double submit_time;
+        double deadline;
+    };
+
+    static void* worker_entry(void* args);
+    void run();
+
+    static void complete(Request& request, int status, std::vector<Object>& objects);
+
+    std::shared_ptr<YOLO11> yolo11;
+    int queue_capacity;
+    Policy policy;
+
+    mutable ncnn::Mutex lock;
+    ncnn::ConditionVariable not_empty;
+    ncnn::ConditionVariable not_full;
+    std::deque<Request> queue;
+    bool quit;
+
+    std::vector<ncnn::Thread*> workers;
+};
+
+#endif // YOLO11ASYNC_H
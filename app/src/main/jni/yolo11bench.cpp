@@ -0,0 +1,1032 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2025 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+// benchmarks and self-checks behind YOLO11Bench, built with -DYOLO11NCNN_BENCHMARK=ON and never shipped
+// every call loads the models it measures, nothing is shared with the camera in libyolo11ncnn
+
+#include <android/asset_manager_jni.h>
+
+#include <android/log.h>
+
+#include <jni.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <errno.h>
+#include <math.h>
+#include <sys/stat.h>
+
+#include <platform.h>
+#include <benchmark.h>
+#include <cpu.h>
+#include <gpu.h>
+#include <layer.h>
+
+#include "yolo11.h"
+#include "modelcache.h"
+#include "yolo11async.h"
+#include "yolo11dfl.h"
+#include "yolo11nms.h"
+#include "yolo11tiled.h"
+
+#include <opencv2/core/core.hpp>
+
+// dummy inferences before measuring, like the loader does before publishing
+static const int warmup_loop_count = 3;
+
+// noise frames so post-processing sees proposals too
+static void make_noise_frames(int count, std::vector<cv::Mat>& rgbs, int width = 640, int height = 480)
+{
+    rgbs.resize(count);
+
+    unsigned int seed = 12345;
+    for (int i = 0; i < count; i++)
+    {
+        rgbs[i].create(height, width, CV_8UC3);
+
+        unsigned char* p = rgbs[i].data;
+        for (size_t j = 0; j < rgbs[i].total() * 3; j++)
+        {
+            seed = seed * 1103515245 + 12345;
+            p[j] = (unsigned char)(seed >> 16);
+        }
+    }
+}
+
+static bool same_objects(const std::vector<Object>& a, const std::vector<Object>& b)
+{
+    if (a.size() != b.size())
+        return false;
+
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        if (a[i].label != b[i].label || a[i].prob != b[i].prob || a[i].rect != b[i].rect)
+            return false;
+    }
+
+    return true;
+}
+
+// cls objects have no box, two empty boxes are the same
+static inline float intersection_over_union(const cv::Rect_<float>& a, const cv::Rect_<float>& b)
+{
+    cv::Rect_<float> inter = a & b;
+    float inter_area = inter.area();
+    float union_area = a.area() + b.area() - inter_area;
+    if (union_area <= 0.f)
+        return a == b ? 1.f : 0.f;
+    return inter_area / union_area;
+}
+
+// float rounding moves boxes and scores a little, match each expected box to its best overlap
+static int compare_objects(const std::vector<Object>& expected, const std::vector<Object>& objects, float& max_prob_diff, float& min_iou)
+{
+    int mismatches = (int)std::max(expected.size(), objects.size()) - (int)std::min(expected.size(), objects.size());
+
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+        int best = -1;
+        float best_iou = 0.f;
+        for (size_t j = 0; j < objects.size(); j++)
+        {
+            if (objects[j].label != expected[i].label)
+                continue;
+
+            float iou = intersection_over_union(expected[i].rect, objects[j].rect);
+            if (iou > best_iou)
+            {
+                best = (int)j;
+                best_iou = iou;
+            }
+        }
+
+        if (best == -1 || best_iou < 0.9f)
+        {
+            mismatches++;
+            continue;
+        }
+
+        max_prob_diff = std::max(max_prob_diff, fabsf(expected[i].prob - objects[best].prob));
+        min_iou = std::min(min_iou, best_iou);
+    }
+
+    return mismatches;
+}
+
+// as in yolo11ncnn.cpp, except that only the default vulkan driver is available here
+static bool resolve_model_key(AAssetManager* mgr, jint taskid, jint modelid, jint cpugpu, ModelKey& key, int& target_size)
+{
+    if (taskid < 0 || taskid > 4 || modelid < 0 || modelid > 17 || cpugpu < 0 || cpugpu > 1)
+    {
+        return false;
+    }
+
+    const bool use_int8 = (int)modelid >= 9;
+    const int sizeid = (int)modelid % 9;
+
+    key.taskid = (int)taskid;
+    key.modeltype = sizeid % 3;
+    key.use_int8 = use_int8;
+    key.backend = (int)cpugpu;
+
+    // int8 files that are not packaged fall back to fp32, int8 always runs on cpu
+    if (key.use_int8 && !ModelCache::has_assets(mgr, key))
+        key.use_int8 = false;
+    if (key.use_int8)
+        key.backend = 0;
+
+    target_size = 320;
+    if (sizeid >= 3)
+        target_size = 480;
+    if (sizeid >= 6)
+        target_size = 640;
+
+    return true;
+}
+
+// model for the request at its nominal size and warmed up, 0 on failure
+static YOLO11* load_model(AAssetManager* mgr, jint taskid, jint modelid, jint cpugpu)
+{
+    ModelKey key;
+    int target_size = 320;
+    if (!resolve_model_key(mgr, taskid, modelid, cpugpu, key, target_size))
+        return 0;
+
+    YOLO11* yolo11 = ModelCache::create(mgr, key);
+    if (!yolo11)
+        return 0;
+
+    yolo11->set_det_target_size(target_size);
+    yolo11->warmup(warmup_loop_count);
+
+    return yolo11;
+}
+
+struct StressWorker
+{
+    YOLO11* yolo11;
+    const std::vector<cv::Mat>* rgbs;
+    const std::vector<std::vector<Object> >* expected;
+    int iterations;
+    int mismatches;
+};
+
+static void* stress_entry(void* args)
+{
+    StressWorker* worker = (StressWorker*)args;
+
+    const std::vector<cv::Mat>& rgbs = *worker->rgbs;
+    for (int i = 0; i < worker->iterations; i++)
+    {
+        const int index = i % (int)rgbs.size();
+
+        std::vector<Object> objects;
+        worker->yolo11->detect(rgbs[index], objects);
+
+        if (!same_objects(objects, (*worker->expected)[index]))
+            worker->mismatches++;
+    }
+
+    return 0;
+}
+
+// the input of one nms_detections call
+struct NmsSet
+{
+    std::vector<Detection> proposals;
+    float nms_threshold;
+    int top_k;
+    int max_det;
+    bool agnostic;
+};
+
+// crowded trays at a low threshold, clusters of jittered boxes over a few classes in a 640x640 letterbox
+static void make_crowded_proposals(int count, std::vector<NmsSet>& sets)
+{
+    const int clusters = 60;
+    const int cluster_size = 25;
+
+    sets.resize(count);
+
+    unsigned int seed = 12345;
+    for (int i = 0; i < count; i++)
+    {
+        NmsSet& r = sets[i];
+        r.proposals.clear();
+        r.nms_threshold = 0.45f;
+        r.top_k = 1000;
+        r.max_det = 300;
+        r.agnostic = false;
+
+        for (int c = 0; c < clusters; c++)
+        {
+            seed = seed * 1103515245 + 12345;
+            const float cx = (float)((seed >> 16) % 640);
+            seed = seed * 1103515245 + 12345;
+            const float cy = (float)((seed >> 16) % 640);
+            seed = seed * 1103515245 + 12345;
+            const float side = 16.f + (seed >> 16) % 128;
+
+            for (int j = 0; j < cluster_size; j++)
+            {
+                seed = seed * 1103515245 + 12345;
+                const float dx = ((seed >> 16) % 1000 / 1000.f - 0.5f) * side * 0.3f;
+                seed = seed * 1103515245 + 12345;
+                const float dy = ((seed >> 16) % 1000 / 1000.f - 0.5f) * side * 0.3f;
+                seed = seed * 1103515245 + 12345;
+
+                Detection d;
+                d.x0 = cx - side * 0.5f + dx;
+                d.y0 = cy - side * 0.5f + dy;
+                d.x1 = cx + side * 0.5f + dx;
+                d.y1 = cy + side * 0.5f + dy;
+                d.angle = 0.f;
+                d.prob = 0.25f + (seed >> 16) % 750 / 1000.f;
+                d.label = c % 4;
+                d.gindex = (int)r.proposals.size();
+                r.proposals.push_back(d);
+            }
+        }
+    }
+}
+
+// what det, seg and pose did before yolo11nms.h, sort the proposals and test every pair
+static void nms_pairwise(const NmsSet& r, std::vector<int>& picked)
+{
+    std::vector<std::pair<float, int> > order(r.proposals.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        order[i] = std::make_pair(-r.proposals[i].prob, (int)i);
+    }
+    std::sort(order.begin(), order.end());
+
+    if (r.top_k > 0 && (int)order.size() > r.top_k)
+        order.resize(r.top_k);
+
+    std::vector<cv::Rect_<float> > rects(order.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        const Detection& d = r.proposals[order[i].second];
+        rects[i] = cv::Rect_<float>(d.x0, d.y0, d.x1 - d.x0, d.y1 - d.y0);
+    }
+
+    std::vector<int> kept;
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        int keep = 1;
+        for (size_t j = 0; j < kept.size(); j++)
+        {
+            if (!r.agnostic && r.proposals[order[i].second].label != r.proposals[order[kept[j]].second].label)
+                continue;
+
+            float inter_area = (rects[i] & rects[kept[j]]).area();
+            float union_area = rects[i].area() + rects[kept[j]].area() - inter_area;
+            if (inter_area / union_area > r.nms_threshold)
+                keep = 0;
+        }
+
+        if (keep)
+            kept.push_back((int)i);
+    }
+
+    if (r.max_det > 0 && (int)kept.size() > r.max_det)
+        kept.resize(r.max_det);
+
+    picked.resize(kept.size());
+    for (size_t i = 0; i < kept.size(); i++)
+    {
+        picked[i] = order[kept[i]].second;
+    }
+}
+
+// det that also keeps the fused decode output of every frame, the proposals its nms_detections call gets
+class ProposalRecorder : public YOLO11_det
+{
+public:
+    std::vector<NmsSet> sets;
+
+    using YOLO11::detect;
+    virtual int detect(const Letterbox& lb, std::vector<Object>& objects, YOLO11Context& ctx)
+    {
+        if (has_output("dets"))
+        {
+            const int max_candidates = 300;
+
+            ncnn::Extractor ex = yolo11.create_extractor();
+            ex.input("in0", lb.in_pad);
+
+            float decode_param[4] = {(float)lb.in_pad.w, (float)lb.in_pad.h, get_prob_threshold(), (float)max_candidates};
+            ex.input("decode_param", ncnn::Mat(4, decode_param));
+
+            ncnn::Mat dets;
+            ex.extract("dets", dets);
+
+            const int count = dets.empty() ? 0 : std::min((int)dets.row(0)[0], dets.h - 1);
+
+            NmsSet r;
+            r.proposals.resize(count);
+            r.nms_threshold = 0.45f;
+            r.top_k = max_candidates;
+            r.max_det = 0;
+            r.agnostic = false;
+            for (int i = 0; i < count; i++)
+            {
+                const float* p = dets.row(i + 1);
+
+                Detection& d = r.proposals[i];
+                d.x0 = p[0];
+                d.y0 = p[1];
+                d.x1 = p[2];
+                d.y1 = p[3];
+                d.angle = 0.f;
+                d.prob = p[4];
+                d.label = (int)p[5];
+                d.gindex = i;
+            }
+
+            sets.push_back(r);
+        }
+
+        return YOLO11_det::detect(lb, objects, ctx);
+    }
+};
+
+// proposal sets of a det model on noise frames at a low threshold, empty if the model was not loaded with the fused decode
+static void record_proposals(AAssetManager* mgr, jint modelid, jint cpugpu, int count, std::vector<NmsSet>& sets)
+{
+    ModelKey key;
+    int target_size = 320;
+    if (!resolve_model_key(mgr, 0, modelid, cpugpu, key, target_size))
+        return;
+
+    std::string parampath;
+    std::string modelpath;
+    ModelCache::model_paths(key, parampath, modelpath);
+
+    ProposalRecorder recorder;
+    recorder.set_prob_threshold(0.25f);
+    recorder.set_det_target_size(target_size);
+    if (recorder.load(mgr, parampath.c_str(), modelpath.c_str(), key.backend != 0) != 0)
+        return;
+
+    std::vector<cv::Mat> rgbs;
+    make_noise_frames(count, rgbs);
+
+    std::vector<Object> objects;
+    for (int i = 0; i < count; i++)
+    {
+        recorder.detect(rgbs[i], objects);
+    }
+
+    sets.swap(recorder.sets);
+}
+
+// replay sets through the pairwise reference and nms_detections, count times each
+static int replay_nms(const std::vector<NmsSet>& sets, int count, const char* source, std::string& text)
+{
+    size_t proposal_count = 0;
+    for (size_t i = 0; i < sets.size(); i++)
+    {
+        proposal_count += sets[i].proposals.size();
+    }
+
+    std::vector<std::vector<int> > expected(sets.size());
+    std::vector<int> picked;
+
+    double t0 = ncnn::get_current_time();
+    for (int k = 0; k < count; k++)
+    {
+        for (size_t i = 0; i < sets.size(); i++)
+        {
+            nms_pairwise(sets[i], expected[i]);
+        }
+    }
+    double t1 = ncnn::get_current_time();
+
+    NmsWorkspace ws;
+    int mismatches = 0;
+    for (int k = 0; k < count; k++)
+    {
+        for (size_t i = 0; i < sets.size(); i++)
+        {
+            const NmsSet& r = sets[i];
+            nms_detections(r.proposals, picked, r.nms_threshold, r.top_k, r.max_det, r.agnostic, ws);
+
+            if (k == 0 && picked != expected[i])
+                mismatches++;
+        }
+    }
+    double t2 = ncnn::get_current_time();
+
+    const int runs = std::max(count * (int)sets.size(), 1);
+    const size_t set_count = std::max(sets.size(), (size_t)1);
+
+    char line[256];
+    sprintf(line, "nms %d %s sets %.0f proposals each pairwise %.3fms engine %.3fms per set mismatches %d\n", (int)sets.size(), source, (double)proposal_count / set_count, (t1 - t0) / runs, (t2 - t1) / runs, mismatches);
+    text += line;
+
+    return mismatches;
+}
+
+// completions of an async front-end by status, OK DROPPED EXPIRED CANCELLED
+struct AsyncCounter
+{
+    std::atomic<int> counts[4];
+    std::atomic<int> completed;
+
+    AsyncCounter() : completed(0)
+    {
+        for (int i = 0; i < 4; i++)
+            counts[i] = 0;
+    }
+
+    YOLO11Async::Callback callback()
+    {
+        return [this](AsyncResult& result) {
+            counts[-result.status]++;
+            completed++;
+        };
+    }
+};
+
+extern "C" {
+
+JNIEXPORT jint JNI_OnLoad(JavaVM* vm, void* reserved)
+{
+    __android_log_print(ANDROID_LOG_DEBUG, "ncnn", "yolo11bench JNI_OnLoad");
+
+    ncnn::create_gpu_instance();
+
+    return JNI_VERSION_1_4;
+}
+
+JNIEXPORT void JNI_OnUnload(JavaVM* vm, void* reserved)
+{
+    __android_log_print(ANDROID_LOG_DEBUG, "ncnn", "yolo11bench JNI_OnUnload");
+
+    ncnn::destroy_gpu_instance();
+}
+
+// public native String benchmarkBatch(AssetManager mgr, int taskid, int modelid, int cpugpu, int count);
+JNIEXPORT jstring JNICALL Java_com_tencent_yolo11ncnn_YOLO11Bench_benchmarkBatch(JNIEnv* env, jobject thiz, jobject assetManager, jint taskid, jint modelid, jint cpugpu, jint count)
+{
+    if (count <= 0)
+        return env->NewStringUTF("");
+
+    AAssetManager* mgr = AAssetManager_fromJava(env, assetManager);
+
+    std::unique_ptr<YOLO11> yolo11(load_model(mgr, taskid, modelid, cpugpu));
+    if (!yolo11)
+        return env->NewStringUTF("");
+
+    std::vector<cv::Mat> rgbs;
+    make_noise_frames(count, rgbs);
+
+    std::string text;
+    char line[128];
+
+    // one image at a time over all threads, what the camera does
+    {
+        std::vector<Object> objects;
+        yolo11->detect(rgbs[0], objects);
+
+        double t0 = ncnn::get_current_time();
+        for (int i = 0; i < count; i++)
+        {
+            yolo11->detect(rgbs[i], objects);
+        }
+        double t1 = ncnn::get_current_time();
+
+        sprintf(line, "sequential %.2f img/s\n", count * 1000 / (t1 - t0));
+        text += line;
+    }
+
+    const int cpu_count = ncnn::get_cpu_count();
+    for (int num_threads = 1; num_threads <= cpu_count; num_threads++)
+    {
+        std::vector<std::vector<Object> > objects;
+
+        // first batch at this width fills the worker pools
+        yolo11->detect_batch(rgbs, objects, num_threads);
+
+        double t0 = ncnn::get_current_time();
+        yolo11->detect_batch(rgbs, objects, num_threads);
+        double t1 = ncnn::get_current_time();
+
+        sprintf(line, "batch x%d %.2f img/s\n", num_threads, count * 1000 / (t1 - t0));
+        text += line;
+    }
+
+    __android_log_print(ANDROID_LOG_DEBUG, "ncnn", "benchmarkBatch %d\n%s", (int)count, text.c_str());
+
+    return env->NewStringUTF(text.c_str());
+}
+
+// public native String stressTest(AssetManager mgr, int taskid, int modelid, int cpugpu, int threads, int iterations);
+JNIEXPORT jstring JNICALL Java_com_tencent_yolo11ncnn_YOLO11Bench_stressTest(JNIEnv* env, jobject thiz, jobject assetManager, jint taskid, jint modelid, jint cpugpu, jint threads, jint iterations)
+{
+    if (threads <= 0 || iterations <= 0)
+        return env->NewStringUTF("");
+
+    AAssetManager* mgr = AAssetManager_fromJava(env, assetManager);
+
+    std::unique_ptr<YOLO11> yolo11(load_model(mgr, taskid, modelid, cpugpu));
+    if (!yolo11)
+        return env->NewStringUTF("");
+
+    std::vector<cv::Mat> rgbs;
+    make_noise_frames(8, rgbs);
+
+    // every concurrent detect on the one shared net must match a lone detect
+    std::vector<std::vector<Object> > expected(rgbs.size());
+    for (size_t i = 0; i < rgbs.size(); i++)
+    {
+        yolo11->detect(rgbs[i], expected[i]);
+    }
+
+    std::vector<StressWorker> workers(threads);
+    std::vector<ncnn::Thread*> worker_threads(threads);
+
+    double t0 = ncnn::get_current_time();
+
+    for (int i = 0; i < threads; i++)
+    {
+        workers[i].yolo11 = yolo11.get();
+        workers[i].rgbs = &rgbs;
+        workers[i].expected = &expected;
+        workers[i].iterations = iterations;
+        workers[i].mismatches = 0;
+
+        worker_threads[i] = new ncnn::Thread(stress_entry, &workers[i]);
+    }
+
+    int mismatches = 0;
+    for (int i = 0; i < threads; i++)
+    {
+        worker_threads[i]->join();
+        delete worker_threads[i];
+
+        mismatches += workers[i].mismatches;
+    }
+
+    double t1 = ncnn::get_current_time();
+
+    char text[128];
+    sprintf(text, "stress x%d %d detects %.2f img/s mismatches %d", (int)threads, (int)(threads * iterations), threads * iterations * 1000 / (t1 - t0), mismatches);
+
+    __android_log_print(mismatches ? ANDROID_LOG_ERROR : ANDROID_LOG_DEBUG, "ncnn", "%s", text);
+
+    yolo11->print_pool_stats();
+
+    return env->NewStringUTF(text);
+}
+
+// public native String checkFoldParity(AssetManager mgr, int taskid, int modelid, int cpugpu);
+JNIEXPORT jstring JNICALL Java_com_tencent_yolo11ncnn_YOLO11Bench_checkFoldParity(JNIEnv* env, jobject thiz, jobject assetManager, jint taskid, jint modelid, jint cpugpu)
+{
+    AAssetManager* mgr = AAssetManager_fromJava(env, assetManager);
+
+    ModelKey key;
+    int target_size = 320;
+    if (!resolve_model_key(mgr, taskid, modelid, cpugpu, key, target_size))
+        return env->NewStringUTF("");
+
+    // the folded graph against the original with normalization on the cpu
+    std::unique_ptr<YOLO11> folded(ModelCache::create(mgr, key, true));
+    std::unique_ptr<YOLO11> original(ModelCache::create(mgr, key, false));
+    if (!folded || !original)
+        return env->NewStringUTF("");
+
+    folded->set_det_target_size(target_size);
+    original->set_det_target_size(target_size);
+
+    std::vector<cv::Mat> rgbs;
+    make_noise_frames(8, rgbs);
+
+    int objects_count = 0;
+    int mismatches = 0;
+    float max_prob_diff = 0.f;
+    float min_iou = 1.f;
+    for (size_t i = 0; i < rgbs.size(); i++)
+    {
+        std::vector<Object> expected;
+        std::vector<Object> objects;
+        original->detect(rgbs[i], expected);
+        folded->detect(rgbs[i], objects);
+
+        objects_count += (int)expected.size();
+        mismatches += compare_objects(expected, objects, max_prob_diff, min_iou);
+    }
+
+    char text[160];
+    sprintf(text, "fold parity %s %d objects mismatches %d max prob diff %.5f min iou %.4f", folded->is_normalize_folded() ? "folded" : "not folded", objects_count, mismatches, max_prob_diff, min_iou);
+
+    __android_log_print(mismatches ? ANDROID_LOG_ERROR : ANDROID_LOG_DEBUG, "ncnn", "%s", text);
+
+    return env->NewStringUTF(text);
+}
+
+// public native String benchmarkLoad(AssetManager mgr, int taskid, int cpugpu, String cacheDir);
+JNIEXPORT jstring JNICALL Java_com_tencent_yolo11ncnn_YOLO11Bench_benchmarkLoad(JNIEnv* env, jobject thiz, jobject assetManager, jint taskid, jint cpugpu, jstring cacheDir)
+{
+    AAssetManager* mgr = AAssetManager_fromJava(env, assetManager);
+
+    const char* path = env->GetStringUTFChars(cacheDir, 0);
+    std::string cache_dir = path;
+    env->ReleaseStringUTFChars(cacheDir, path);
+
+    if (mkdir(cache_dir.c_str(), 0700) != 0 && errno != EEXIST)
+        return env->NewStringUTF("");
+
+    ModelCache::set_rewrite_cache_dir(cache_dir);
+
+    const char* modeltypes[3] = {"n", "s", "m"};
+
+    std::string text;
+    char line[128];
+
+    for (int modeltype = 0; modeltype < 3; modeltype++)
+    {
+        ModelKey key;
+        int target_size = 320;
+        if (!resolve_model_key(mgr, taskid, modeltype, cpugpu, key, target_size))
+            return env->NewStringUTF("");
+
+        // assets alone, then the cache is filled unless an earlier run did, then it is a hit
+        float latency[3] = {0.f, 0.f, 0.f};
+        for (int i = 0; i < 3; i++)
+        {
+            double t0 = ncnn::get_current_time();
+            YOLO11* yolo11 = ModelCache::create(mgr, key, true, i != 0);
+            double t1 = ncnn::get_current_time();
+
+            if (!yolo11)
+                return env->NewStringUTF("");
+
+            delete yolo11;
+
+            latency[i] = (float)(t1 - t0);
+        }
+
+        sprintf(line, "load %s uncached %.2fms first cached %.2fms warm %.2fms\n", modeltypes[modeltype], latency[0], latency[1], latency[2]);
+        text += line;
+    }
+
+    __android_log_print(ANDROID_LOG_DEBUG, "ncnn", "benchmarkLoad %d\n%s", (int)taskid, text.c_str());
+
+    return env->NewStringUTF(text.c_str());
+}
+
+// public native String checkAsync(AssetManager mgr, int taskid, int modelid, int cpugpu);
+JNIEXPORT jstring JNICALL Java_com_tencent_yolo11ncnn_YOLO11Bench_checkAsync(JNIEnv* env, jobject thiz, jobject assetManager, jint taskid, jint modelid, jint cpugpu)
+{
+    AAssetManager* mgr = AAssetManager_fromJava(env, assetManager);
+
+    std::shared_ptr<YOLO11> yolo11(load_model(mgr, taskid, modelid, cpugpu));
+    if (!yolo11)
+        return env->NewStringUTF("");
+
+    std::vector<cv::Mat> rgbs;
+    make_noise_frames(8, rgbs);
+
+    int failures = 0;
+
+    // a burst into one worker and one slot drops all but the running and the newest frame
+    AsyncCounter backpressure;
+    {
+        YOLO11Async async(yolo11, 1, 1, YOLO11Async::DROP_OLDEST);
+        for (size_t i = 0; i < rgbs.size(); i++)
+        {
+            async.submit(rgbs[i], backpressure.callback());
+        }
+
+        while (backpressure.completed < (int)rgbs.size())
+        {
+            ncnn::sleep(1);
+        }
+    }
+    if (backpressure.counts[-YOLO11Async::DROPPED] == 0 || backpressure.counts[-YOLO11Async::OK] == 0 || backpressure.counts[-YOLO11Async::OK] + backpressure.counts[-YOLO11Async::DROPPED] != (int)rgbs.size())
+        failures++;
+
+    // blocking submits never drop
+    int blocked_ok = 0;
+    {
+        YOLO11Async async(yolo11, 1, 1, YOLO11Async::BLOCK);
+
+        std::vector<std::future<AsyncResult> > futures;
+        for (size_t i = 0; i < rgbs.size(); i++)
+        {
+            futures.push_back(async.submit(rgbs[i]));
+        }
+
+        for (size_t i = 0; i < futures.size(); i++)
+        {
+            if (futures[i].get().status == YOLO11Async::OK)
+                blocked_ok++;
+        }
+    }
+    if (blocked_ok != (int)rgbs.size())
+        failures++;
+
+    // a request queued behind a detect outlives a 0.01ms deadline
+    int deadline_status = 0;
+    {
+        YOLO11Async async(yolo11, 1, 2, YOLO11Async::BLOCK);
+
+        std::future<AsyncResult> first = async.submit(rgbs[0]);
+        std::future<AsyncResult> late = async.submit(rgbs[1], 0.01f);
+
+        if (first.get().status != YOLO11Async::OK)
+            failures++;
+
+        deadline_status = late.get().status;
+    }
+    if (deadline_status != YOLO11Async::EXPIRED)
+        failures++;
+
+    // destroying with a full queue cancels what is queued, every request completes once
+    AsyncCounter shutdown;
+    {
+        YOLO11Async async(yolo11, 1, 4, YOLO11Async::BLOCK);
+        for (int i = 0; i < 4; i++)
+        {
+            async.submit(rgbs[i], shutdown.callback());
+        }
+    }
+    if (shutdown.completed != 4 || shutdown.counts[-YOLO11Async::CANCELLED] == 0 || shutdown.counts[-YOLO11Async::OK] + shutdown.counts[-YOLO11Async::CANCELLED] != 4)
+        failures++;
+
+    char text[256];
+    sprintf(text, "async burst ok %d dropped %d block ok %d deadline %d shutdown ok %d cancelled %d failures %d",
+            (int)backpressure.counts[-YOLO11Async::OK], (int)backpressure.counts[-YOLO11Async::DROPPED], blocked_ok, deadline_status,
+            (int)shutdown.counts[-YOLO11Async::OK], (int)shutdown.counts[-YOLO11Async::CANCELLED], failures);
+
+    __android_log_print(failures ? ANDROID_LOG_ERROR : ANDROID_LOG_DEBUG, "ncnn", "%s", text);
+
+    return env->NewStringUTF(text);
+}
+
+// public native String benchmarkHeadLayout(AssetManager mgr, int modelid, int cpugpu, int count);
+JNIEXPORT jstring JNICALL Java_com_tencent_yolo11ncnn_YOLO11Bench_benchmarkHeadLayout(JNIEnv* env, jobject thiz, jobject assetManager, jint modelid, jint cpugpu, jint count)
+{
+    AAssetManager* mgr = AAssetManager_fromJava(env, assetManager);
+
+    ModelKey key;
+    int target_size = 320;
+    if (count <= 0 || !resolve_model_key(mgr, 0, modelid, cpugpu, key, target_size))
+        return env->NewStringUTF("");
+
+    std::unique_ptr<YOLO11> yolo11(ModelCache::create(mgr, key));
+    YOLO11_det* det = dynamic_cast<YOLO11_det*>(yolo11.get());
+    if (!det)
+        return env->NewStringUTF("");
+
+    det->set_det_target_size(target_size);
+
+    std::vector<cv::Mat> rgbs;
+    make_noise_frames(count, rgbs);
+
+    // the default threshold and the low one of the other tasks, which lets more anchors through
+    const float prob_thresholds[2] = {0.86f, 0.25f};
+    const char* layouts[2] = {"anchor-major", "class-major"};
+
+    std::vector<std::vector<Object> > expected(count);
+
+    std::string text;
+    char line[160];
+
+    for (int t = 0; t < 2; t++)
+    {
+        det->set_prob_threshold(prob_thresholds[t]);
+
+        for (int split = 0; split < 2; split++)
+        {
+            // rebuilt from the mapped weights, the file is not read again
+            det->set_split_head(split == 1);
+            if (det->reload() != 0 || det->is_head_split() != (split == 1))
+                return env->NewStringUTF("");
+
+            std::vector<Object> objects;
+            det->detect(rgbs[0], objects);
+
+            int mismatches = 0;
+            float max_prob_diff = 0.f;
+            float min_iou = 1.f;
+
+            double t0 = ncnn::get_current_time();
+            for (int i = 0; i < count; i++)
+            {
+                det->detect(rgbs[i], objects);
+
+                if (split == 0)
+                    expected[i] = objects;
+                else
+                    mismatches += compare_objects(expected[i], objects, max_prob_diff, min_iou);
+            }
+            double t1 = ncnn::get_current_time();
+
+            sprintf(line, "%s threshold %.2f %.2fms", layouts[split], prob_thresholds[t], (t1 - t0) / count);
+            text += line;
+
+            if (split == 1)
+            {
+                sprintf(line, " mismatches %d", mismatches);
+                text += line;
+            }
+
+            text += "\n";
+        }
+    }
+
+    __android_log_print(ANDROID_LOG_DEBUG, "ncnn", "benchmarkHeadLayout %d\n%s", (int)modelid, text.c_str());
+
+    return env->NewStringUTF(text.c_str());
+}
+
+// public native String benchmarkDfl(int count);
+JNIEXPORT jstring JNICALL Java_com_tencent_yolo11ncnn_YOLO11Bench_benchmarkDfl(JNIEnv* env, jobject thiz, jint count)
+{
+    if (count <= 0)
+        return env->NewStringUTF("");
+
+    const int reg_max = 16;
+
+    // logits in the range the head produces
+    std::vector<float> bins(count * reg_max * 4);
+    unsigned int seed = 12345;
+    for (size_t i = 0; i < bins.size(); i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        bins[i] = (seed >> 16) / 65536.f * 16.f - 8.f;
+    }
+
+    std::vector<float> expected(count * 4);
+    std::vector<float> decoded(count * 4);
+
+    // what the proposal loops did per candidate before yolo11dfl.h
+    double t0 = ncnn::get_current_time();
+    for (int i = 0; i < count; i++)
+    {
+        ncnn::Mat pred_bbox = ncnn::Mat(reg_max * 4, &bins[i * reg_max * 4]).reshape(reg_max, 4).clone();
+
+        {
+            ncnn::Layer* softmax = ncnn::create_layer("Softmax");
+
+            ncnn::ParamDict pd;
+            pd.set(0, 1); // axis
+            pd.set(1, 1);
+            softmax->load_param(pd);
+
+            ncnn::Option opt;
+            opt.num_threads = 1;
+            opt.use_packing_layout = false;
+
+            softmax->create_pipeline(opt);
+
+            softmax->forward_inplace(pred_bbox, opt);
+
+            softmax->destroy_pipeline(opt);
+
+            delete softmax;
+        }
+
+        for (int k = 0; k < 4; k++)
+        {
+            float dis = 0.f;
+            const float* dis_after_sm = pred_bbox.row(k);
+            for (int l = 0; l < reg_max; l++)
+            {
+                dis += l * dis_after_sm[l];
+            }
+
+            expected[i * 4 + k] = dis;
+        }
+    }
+    double t1 = ncnn::get_current_time();
+
+    for (int i = 0; i < count; i++)
+    {
+        dfl_decode(&bins[i * reg_max * 4], reg_max, &decoded[i * 4]);
+    }
+    double t2 = ncnn::get_current_time();
+
+    float max_diff = 0.f;
+    for (int i = 0; i < count * 4; i++)
+    {
+        max_diff = std::max(max_diff, fabsf(expected[i] - decoded[i]));
+    }
+
+    char text[160];
+    sprintf(text, "dfl %d anchors softmax layer %.1fns shared %.1fns per anchor max diff %.6f", (int)count, (t1 - t0) * 1e6 / count, (t2 - t1) * 1e6 / count, max_diff);
+
+    __android_log_print(ANDROID_LOG_DEBUG, "ncnn", "%s", text);
+
+    return env->NewStringUTF(text);
+}
+
+// public native String benchmarkNms(AssetManager mgr, int modelid, int cpugpu, int count);
+JNIEXPORT jstring JNICALL Java_com_tencent_yolo11ncnn_YOLO11Bench_benchmarkNms(JNIEnv* env, jobject thiz, jobject assetManager, jint modelid, jint cpugpu, jint count)
+{
+    if (count <= 0)
+        return env->NewStringUTF("");
+
+    AAssetManager* mgr = AAssetManager_fromJava(env, assetManager);
+
+    // synthetic crowded sets, and the sets a det model hands to nms on noise frames
+    std::vector<NmsSet> synthetic;
+    make_crowded_proposals(16, synthetic);
+
+    std::vector<NmsSet> recorded;
+    record_proposals(mgr, modelid, cpugpu, 8, recorded);
+
+    std::string text;
+    int mismatches = replay_nms(synthetic, count, "synthetic", text);
+    mismatches += replay_nms(recorded, count, "recorded", text);
+
+    __android_log_print(mismatches ? ANDROID_LOG_ERROR : ANDROID_LOG_DEBUG, "ncnn", "%s", text.c_str());
+
+    return env->NewStringUTF(text.c_str());
+}
+
+// public native String benchmarkTiled(AssetManager mgr, int taskid, int modelid, int cpugpu, int count);
+JNIEXPORT jstring JNICALL Java_com_tencent_yolo11ncnn_YOLO11Bench_benchmarkTiled(JNIEnv* env, jobject thiz, jobject assetManager, jint taskid, jint modelid, jint cpugpu, jint count)
+{
+    if (count <= 0)
+        return env->NewStringUTF("");
+
+    AAssetManager* mgr = AAssetManager_fromJava(env, assetManager);
+
+    std::unique_ptr<YOLO11> yolo11(load_model(mgr, taskid, modelid, cpugpu));
+    if (!yolo11)
+        return env->NewStringUTF("");
+
+    // 1080p, the frames tiling is for
+    std::vector<cv::Mat> rgbs;
+    make_noise_frames(count, rgbs, 1920, 1080);
+
+    std::string text;
+    char line[128];
+
+    // letterboxed down to det_target_size in one pass
+    {
+        std::vector<Object> objects;
+        yolo11->detect(rgbs[0], objects);
+
+        int object_count = 0;
+        double t0 = ncnn::get_current_time();
+        for (int i = 0; i < count; i++)
+        {
+            yolo11->detect(rgbs[i], objects);
+            object_count += (int)objects.size();
+        }
+        double t1 = ncnn::get_current_time();
+
+        sprintf(line, "whole %.2f ms %d objects\n", (t1 - t0) / count, object_count);
+        text += line;
+    }
+
+    // tiles at native scale, without and with the coarse pass
+    for (int coarse = 0; coarse < 2; coarse++)
+    {
+        YOLO11Tiled tiled;
+        tiled.set_overlap(0.2f);
+        tiled.set_coarse(coarse != 0);
+
+        // first frame fills the context pool
+        std::vector<Object> objects;
+        tiled.detect(*yolo11, rgbs[0], objects);
+
+        int object_count = 0;
+        double t0 = ncnn::get_current_time();
+        for (int i = 0; i < count; i++)
+        {
+            tiled.detect(*yolo11, rgbs[i], objects);
+            object_count += (int)objects.size();
+        }
+        double t1 = ncnn::get_current_time();
+
+        sprintf(line, "tiled%s %.2f ms %d objects\n", coarse ? "+coarse" : "", (t1 - t0) / count, object_count);
+        text += line;
+    }
+
+    __android_log_print(ANDROID_LOG_DEBUG, "ncnn", "benchmarkTiled %d\n%s", (int)count, text.c_str());
+
+    return env->NewStringUTF(text.c_str());
+}
+
+}
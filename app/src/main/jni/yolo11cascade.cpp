@@ -0,0 +1,181 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2025 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "yolo11cascade.h"
+
+#include <algorithm>
+
+#include <cpu.h>
+
+static inline float intersection_over_union(const cv::Rect_<float>& a, const cv::Rect_<float>& b)
+{
+    cv::Rect_<float> inter = a & b;
+    float inter_area = inter.area();
+    float union_area = a.area() + b.area() - inter_area;
+    return union_area > 0.f ? inter_area / union_area : 0.f;
+}
+
+YOLO11Cascade::YOLO11Cascade(const std::shared_ptr<YOLO11>& _det, const std::shared_ptr<YOLO11>& _cls)
+    : det(_det), cls(_cls)
+{
+    crop_budget = 8;
+    reuse_iou = 0.9f;
+    max_reuse_frames = 30;
+    min_prob = 0.5f;
+}
+
+void YOLO11Cascade::set_crop_budget(int max_crops)
+{
+    crop_budget = std::max(max_crops, 0);
+}
+
+void YOLO11Cascade::set_reuse(float iou, int _max_reuse_frames)
+{
+    reuse_iou = iou;
+    max_reuse_frames = _max_reuse_frames;
+}
+
+void YOLO11Cascade::set_label_map(const std::vector<int>& _label_map)
+{
+    label_map = _label_map;
+}
+
+void YOLO11Cascade::set_min_prob(float prob)
+{
+    min_prob = prob;
+}
+
+bool YOLO11Cascade::is_ready() const
+{
+    return det->is_ready() && cls->is_ready();
+}
+
+int YOLO11Cascade::detect(const cv::Mat& rgb, std::vector<Object>& objects)
+{
+    det->detect(rgb, objects);
+
+    const int count = (int)objects.size();
+
+    std::vector<Track> new_tracks(count);
+
+    // carry classes over from boxes that stayed put
+    std::vector<int> pending;
+    for (int i = 0; i < count; i++)
+    {
+        Track& t = new_tracks[i];
+        t.rect = objects[i].rect;
+        t.det_label = objects[i].label;
+        t.label = -1;
+        t.prob = 0.f;
+        t.age = 0;
+
+        int best = -1;
+        float best_iou = reuse_iou;
+        for (size_t j = 0; j < tracks.size(); j++)
+        {
+            if (tracks[j].det_label != t.det_label)
+                continue;
+
+            float iou = intersection_over_union(t.rect, tracks[j].rect);
+            if (iou > best_iou)
+            {
+                best = (int)j;
+                best_iou = iou;
+            }
+        }
+
+        if (best != -1 && tracks[best].label != -1 && tracks[best].age < max_reuse_frames)
+        {
+            t.label = tracks[best].label;
+            t.prob = tracks[best].prob;
+            t.age = tracks[best].age + 1;
+        }
+        else
+        {
+            pending.push_back(i);
+        }
+    }
+
+    // objects come sorted by area, so the budget goes to the largest boxes
+    if ((int)pending.size() > crop_budget)
+        pending.resize(crop_budget);
+
+    const int crop_count = (int)pending.size();
+    if (crop_count > 0)
+    {
+        const int num_threads = std::min(ncnn::get_big_cpu_count(), crop_count);
+
+        std::vector<YOLO11Context*> contexts(num_threads);
+        for (int i = 0; i < num_threads; i++)
+        {
+            contexts[i] = cls->acquire_context();
+            contexts[i]->num_threads = 1;
+        }
+
+        int target_size = 224;
+        bool square = true;
+        cls->get_letterbox_size(target_size, square);
+        const bool normalize = !cls->is_normalize_folded();
+
+        // crop from the decoded frame, letterbox to the classifier input and classify, one crop per thread
+        #pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+        for (int i = 0; i < crop_count; i++)
+        {
+            YOLO11Context& ctx = *contexts[ncnn::get_omp_thread_num()];
+
+            Track& t = new_tracks[pending[i]];
+
+            cv::Rect roi((int)t.rect.x, (int)t.rect.y, std::max((int)t.rect.width, 1), std::max((int)t.rect.height, 1));
+            roi &= cv::Rect(0, 0, rgb.cols, rgb.rows);
+            if (roi.width <= 0 || roi.height <= 0)
+                continue;
+
+            Letterbox lb;
+            YOLO11::letterbox(rgb(roi), target_size, square, normalize, lb, ctx);
+
+            std::vector<Object> topk;
+            cls->detect(lb, topk, ctx);
+
+            if (!topk.empty() && topk[0].label < (int)label_map.size())
+            {
+                t.label = label_map[topk[0].label];
+                t.prob = topk[0].prob;
+            }
+        }
+
+        for (int i = 0; i < num_threads; i++)
+        {
+            cls->release_context(contexts[i]);
+        }
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        const Track& t = new_tracks[i];
+        if (t.label != -1 && t.prob >= min_prob)
+        {
+            objects[i].label = t.label;
+            objects[i].prob = t.prob;
+        }
+    }
+
+    tracks.swap(new_tracks);
+
+    return 0;
+}
+
+int YOLO11Cascade::draw(cv::Mat& rgb, const std::vector<Object>& objects)
+{
+    return det->draw(rgb, objects);
+}
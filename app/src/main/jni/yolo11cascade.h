@@ -0,0 +1,73 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2025 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef YOLO11CASCADE_H
+#define YOLO11CASCADE_H
+
+#include <memory>
+#include <vector>
+
+#include "yolo11.h"
+
+// detect, then refine each box label with a classifier run on its crop
+// the classifier top-1, mapped to a detector label, replaces label and prob
+// boxes that barely moved since the last frame keep their previous class
+class YOLO11Cascade
+{
+public:
+    YOLO11Cascade(const std::shared_ptr<YOLO11>& det, const std::shared_ptr<YOLO11>& cls);
+
+    // crops classified per frame, the largest unclassified boxes go first
+    void set_crop_budget(int max_crops);
+
+    // a box overlapping last frame's box of the same detector label by more than iou reuses its class
+    // for at most max_reuse_frames frames before it is classified again
+    void set_reuse(float iou, int max_reuse_frames);
+
+    // classifier label i becomes detector label label_map[i]
+    // -1 or labels past the end keep the detector label, nothing is replaced until a map is set
+    void set_label_map(const std::vector<int>& label_map);
+
+    // classifier results below this keep the detector label
+    void set_min_prob(float prob);
+
+    bool is_ready() const;
+
+    int detect(const cv::Mat& rgb, std::vector<Object>& objects);
+    int draw(cv::Mat& rgb, const std::vector<Object>& objects);
+
+private:
+    struct Track
+    {
+        cv::Rect_<float> rect;
+        int det_label;
+        int label;
+        float prob;
+        int age;
+    };
+
+    std::shared_ptr<YOLO11> det;
+    std::shared_ptr<YOLO11> cls;
+
+    int crop_budget;
+    float reuse_iou;
+    int max_reuse_frames;
+    float min_prob;
+    std::vector<int> label_map;
+
+    // classified boxes of the previous frame
+    std::vector<Track> tracks;
+};
+
+#endif // YOLO11CASCADE_H
@@ -0,0 +1,153 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2025 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "yolo11decode.h"
+#include "yolo11dfl.h"
+#include "yolo11scan.h"
+
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include <cpu.h>
+
+struct Candidate
+{
+    float x0;
+    float y0;
+    float x1;
+    float y1;
+    float prob;
+    float label;
+};
+
+static bool candidate_prob_greater(const Candidate& a, const Candidate& b)
+{
+    return a.prob > b.prob;
+}
+
+DEFINE_LAYER_CREATOR(YOLO11Decode)
+
+YOLO11Decode::YOLO11Decode()
+{
+    one_blob_only = false;
+    support_inplace = false;
+}
+
+int YOLO11Decode::load_param(const ncnn::ParamDict& pd)
+{
+    reg_max = pd.get(0, 16);
+
+    return 0;
+}
+
+int YOLO11Decode::forward(const std::vector<ncnn::Mat>& bottom_blobs, std::vector<ncnn::Mat>& top_blobs, const ncnn::Option& opt) const
+{
+    const ncnn::Mat& pred = bottom_blobs[0];
+    const ncnn::Mat& settings = bottom_blobs[1];
+
+    const int w = (int)settings[0];
+    const int h = (int)settings[1];
+    const float prob_threshold = settings[2];
+    const int max_candidates = (int)settings[3];
+
+    const int num_class = pred.w - reg_max * 4;
+    if (num_class <= 0)
+        return -1;
+
+    const float score_threshold = prob_to_logit(prob_threshold);
+
+    // ultralytics/cfg/models/v8/yolo11.yaml
+    const int strides[3] = {8, 16, 32};
+
+    int level_end[3];
+    int anchors = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        anchors += (w / strides[i]) * (h / strides[i]);
+        level_end[i] = anchors;
+    }
+
+    if (anchors != pred.h)
+        return -1;
+
+    const int num_threads = std::max(opt.num_threads, 1);
+    std::vector<std::vector<Candidate> > thread_candidates(num_threads);
+
+    // static schedule, thread t decodes the t-th run of rows so the concatenation keeps row order
+    #pragma omp parallel for num_threads(num_threads) schedule(static)
+    for (int i = 0; i < anchors; i++)
+    {
+        const float* p = pred.row(i);
+
+        const float* scores = p + reg_max * 4;
+        const float score = max_score(scores, num_class);
+        if (score < score_threshold)
+            continue;
+
+        const int label = find_score(scores, num_class, score);
+
+        const int level = i < level_end[0] ? 0 : i < level_end[1] ? 1 : 2;
+        const int stride = strides[level];
+        const int num_grid_x = w / stride;
+        const int index = i - (level == 0 ? 0 : level_end[level - 1]);
+
+        const float pb_cx = (index % num_grid_x + 0.5f) * stride;
+        const float pb_cy = (index / num_grid_x + 0.5f) * stride;
+
+        float ltrb[4];
+        dfl_decode(p, reg_max, ltrb);
+
+        Candidate c;
+        c.x0 = pb_cx - ltrb[0] * stride;
+        c.y0 = pb_cy - ltrb[1] * stride;
+        c.x1 = pb_cx + ltrb[2] * stride;
+        c.y1 = pb_cy + ltrb[3] * stride;
+        c.prob = 1.f / (1.f + expf(-score));
+        c.label = (float)label;
+
+        thread_candidates[ncnn::get_omp_thread_num()].push_back(c);
+    }
+
+    std::vector<Candidate> candidates;
+    for (int t = 0; t < num_threads; t++)
+    {
+        candidates.insert(candidates.end(), thread_candidates[t].begin(), thread_candidates[t].end());
+    }
+
+    if (max_candidates > 0 && (int)candidates.size() > max_candidates)
+    {
+        std::partial_sort(candidates.begin(), candidates.begin() + max_candidates, candidates.end(), candidate_prob_greater);
+        candidates.resize(max_candidates);
+    }
+
+    const int count = (int)candidates.size();
+
+    ncnn::Mat& top_blob = top_blobs[0];
+    top_blob.create(6, 1 + count, 4u, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    float* header = top_blob.row(0);
+    memset(header, 0, 6 * sizeof(float));
+    header[0] = (float)count;
+
+    for (int i = 0; i < count; i++)
+    {
+        memcpy(top_blob.row(i + 1), &candidates[i], sizeof(Candidate));
+    }
+
+    return 0;
+}
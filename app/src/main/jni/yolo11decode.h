@@ -0,0 +1,45 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2025 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef YOLO11DECODE_H
+#define YOLO11DECODE_H
+
+#include <layer.h>
+
+// det head decode as an ncnn layer, appended to the graph at load so it runs on the net thread pool
+//
+// bottom 0   head output, w=64+nc h=anchors, the out0 of the det export
+// bottom 1   w=4 runtime settings per extractor
+//              input w, input h, prob threshold, max candidates
+// top 0      w=6 h=1+n, row 0 holds n, then one row per anchor scoring above the threshold
+//              x0 y0 x1 y1 in input pixels, prob, label
+//
+// the class argmax is compared in logit space, only the survivors pay for sigmoid and the dfl softmax
+class YOLO11Decode : public ncnn::Layer
+{
+public:
+    YOLO11Decode();
+
+    virtual int load_param(const ncnn::ParamDict& pd);
+
+    virtual int forward(const std::vector<ncnn::Mat>& bottom_blobs, std::vector<ncnn::Mat>& top_blobs, const ncnn::Option& opt) const;
+
+public:
+    // 0 = 16
+    int reg_max;
+};
+
+ncnn::Layer* YOLO11Decode_layer_creator(void* userdata);
+
+#endif // YOLO11DECODE_H
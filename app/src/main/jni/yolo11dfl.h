@@ -0,0 +1,227 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2025 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef YOLO11DFL_H
+#define YOLO11DFL_H
+
+#include <algorithm>
+
+#include <float.h>
+#include <math.h>
+
+#if __ARM_NEON
+#include <arm_neon.h>
+#endif // __ARM_NEON
+#if __SSE2__
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#endif // __SSE2__
+
+// distribution focal loss box decode shared by every task
+// bins holds reg_max bins for each of the 4 sides left top right bottom, side after side
+// each side is the expectation of the bin index under the softmax of its bins, in grid units
+// the 4 sides go through the 4 lanes at once, nothing is allocated
+
+#if __ARM_NEON
+// cephes exp as in ncnn's neon_mathfun.h, accurate to a few ulp over the softmax range
+static inline float32x4_t dfl_exp_ps(float32x4_t x)
+{
+    x = vminq_f32(x, vdupq_n_f32(88.3762626647949f));
+    x = vmaxq_f32(x, vdupq_n_f32(-88.3762626647949f));
+
+    // express exp(x) as exp(g + n * log(2))
+    float32x4_t fx = vmlaq_f32(vdupq_n_f32(0.5f), x, vdupq_n_f32(1.44269504088896341f));
+
+    // floor, the conversion truncates toward zero
+    float32x4_t tmp = vcvtq_f32_s32(vcvtq_s32_f32(fx));
+    uint32x4_t mask = vcgtq_f32(tmp, fx);
+    fx = vsubq_f32(tmp, vreinterpretq_f32_u32(vandq_u32(mask, vreinterpretq_u32_f32(vdupq_n_f32(1.f)))));
+
+    x = vmlsq_f32(x, fx, vdupq_n_f32(0.693359375f));
+    x = vmlsq_f32(x, fx, vdupq_n_f32(-2.12194440e-4f));
+
+    float32x4_t z = vmulq_f32(x, x);
+
+    float32x4_t y = vdupq_n_f32(1.9875691500E-4f);
+    y = vmlaq_f32(vdupq_n_f32(1.3981999507E-3f), y, x);
+    y = vmlaq_f32(vdupq_n_f32(8.3334519073E-3f), y, x);
+    y = vmlaq_f32(vdupq_n_f32(4.1665795894E-2f), y, x);
+    y = vmlaq_f32(vdupq_n_f32(1.6666665459E-1f), y, x);
+    y = vmlaq_f32(vdupq_n_f32(5.0000001201E-1f), y, x);
+    y = vmlaq_f32(x, y, z);
+    y = vaddq_f32(y, vdupq_n_f32(1.f));
+
+    // 2^n
+    int32x4_t n = vcvtq_s32_f32(fx);
+    n = vshlq_n_s32(vaddq_s32(n, vdupq_n_s32(0x7f)), 23);
+
+    return vmulq_f32(y, vreinterpretq_f32_s32(n));
+}
+
+// bins l..l+3 of the 4 sides, one bin per vector and one side per lane
+static inline void dfl_load4_ps(const float* bins, int reg_max, int l, float32x4_t& c0, float32x4_t& c1, float32x4_t& c2, float32x4_t& c3)
+{
+    float32x4x2_t t01 = vtrnq_f32(vld1q_f32(bins + l), vld1q_f32(bins + reg_max + l));
+    float32x4x2_t t23 = vtrnq_f32(vld1q_f32(bins + reg_max * 2 + l), vld1q_f32(bins + reg_max * 3 + l));
+    c0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+    c1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+    c2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+    c3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+}
+#endif // __ARM_NEON
+
+#if __SSE2__
+static inline __m128 dfl_exp_ps(__m128 x)
+{
+    x = _mm_min_ps(x, _mm_set1_ps(88.3762626647949f));
+    x = _mm_max_ps(x, _mm_set1_ps(-88.3762626647949f));
+
+    __m128 fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)), _mm_set1_ps(0.5f));
+
+    __m128 tmp = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));
+    __m128 mask = _mm_cmpgt_ps(tmp, fx);
+    fx = _mm_sub_ps(tmp, _mm_and_ps(mask, _mm_set1_ps(1.f)));
+
+    x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(0.693359375f)));
+    x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(-2.12194440e-4f)));
+
+    __m128 z = _mm_mul_ps(x, x);
+
+    __m128 y = _mm_set1_ps(1.9875691500E-4f);
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.3981999507E-3f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(8.3334519073E-3f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(4.1665795894E-2f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.6666665459E-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(5.0000001201E-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, z), x);
+    y = _mm_add_ps(y, _mm_set1_ps(1.f));
+
+    __m128i n = _mm_cvttps_epi32(fx);
+    n = _mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(0x7f)), 23);
+
+    return _mm_mul_ps(y, _mm_castsi128_ps(n));
+}
+
+static inline void dfl_load4_ps(const float* bins, int reg_max, int l, __m128& c0, __m128& c1, __m128& c2, __m128& c3)
+{
+    c0 = _mm_loadu_ps(bins + l);
+    c1 = _mm_loadu_ps(bins + reg_max + l);
+    c2 = _mm_loadu_ps(bins + reg_max * 2 + l);
+    c3 = _mm_loadu_ps(bins + reg_max * 3 + l);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+}
+#endif // __SSE2__
+
+static inline void dfl_decode(const float* bins, int reg_max, float* ltrb)
+{
+#if __ARM_NEON
+    if (reg_max % 4 == 0)
+    {
+        float32x4_t c0, c1, c2, c3;
+
+        float32x4_t _max = vdupq_n_f32(-FLT_MAX);
+        for (int l = 0; l < reg_max; l += 4)
+        {
+            dfl_load4_ps(bins, reg_max, l, c0, c1, c2, c3);
+            _max = vmaxq_f32(_max, vmaxq_f32(vmaxq_f32(c0, c1), vmaxq_f32(c2, c3)));
+        }
+
+        // subtracting the max keeps exp in range for any logits
+        float32x4_t _sum = vdupq_n_f32(0.f);
+        float32x4_t _dis = vdupq_n_f32(0.f);
+        for (int l = 0; l < reg_max; l += 4)
+        {
+            dfl_load4_ps(bins, reg_max, l, c0, c1, c2, c3);
+
+            float32x4_t e0 = dfl_exp_ps(vsubq_f32(c0, _max));
+            float32x4_t e1 = dfl_exp_ps(vsubq_f32(c1, _max));
+            float32x4_t e2 = dfl_exp_ps(vsubq_f32(c2, _max));
+            float32x4_t e3 = dfl_exp_ps(vsubq_f32(c3, _max));
+
+            _sum = vaddq_f32(vaddq_f32(_sum, vaddq_f32(e0, e1)), vaddq_f32(e2, e3));
+            _dis = vmlaq_n_f32(_dis, e0, (float)l);
+            _dis = vmlaq_n_f32(_dis, e1, (float)(l + 1));
+            _dis = vmlaq_n_f32(_dis, e2, (float)(l + 2));
+            _dis = vmlaq_n_f32(_dis, e3, (float)(l + 3));
+        }
+
+        float sum[4];
+        float dis[4];
+        vst1q_f32(sum, _sum);
+        vst1q_f32(dis, _dis);
+        for (int k = 0; k < 4; k++)
+        {
+            ltrb[k] = dis[k] / sum[k];
+        }
+        return;
+    }
+#elif __SSE2__
+    if (reg_max % 4 == 0)
+    {
+        __m128 c0, c1, c2, c3;
+
+        __m128 _max = _mm_set1_ps(-FLT_MAX);
+        for (int l = 0; l < reg_max; l += 4)
+        {
+            dfl_load4_ps(bins, reg_max, l, c0, c1, c2, c3);
+            _max = _mm_max_ps(_max, _mm_max_ps(_mm_max_ps(c0, c1), _mm_max_ps(c2, c3)));
+        }
+
+        __m128 _sum = _mm_setzero_ps();
+        __m128 _dis = _mm_setzero_ps();
+        for (int l = 0; l < reg_max; l += 4)
+        {
+            dfl_load4_ps(bins, reg_max, l, c0, c1, c2, c3);
+
+            __m128 e0 = dfl_exp_ps(_mm_sub_ps(c0, _max));
+            __m128 e1 = dfl_exp_ps(_mm_sub_ps(c1, _max));
+            __m128 e2 = dfl_exp_ps(_mm_sub_ps(c2, _max));
+            __m128 e3 = dfl_exp_ps(_mm_sub_ps(c3, _max));
+
+            _sum = _mm_add_ps(_mm_add_ps(_sum, _mm_add_ps(e0, e1)), _mm_add_ps(e2, e3));
+            _dis = _mm_add_ps(_dis, _mm_mul_ps(e0, _mm_set1_ps((float)l)));
+            _dis = _mm_add_ps(_dis, _mm_mul_ps(e1, _mm_set1_ps((float)(l + 1))));
+            _dis = _mm_add_ps(_dis, _mm_mul_ps(e2, _mm_set1_ps((float)(l + 2))));
+            _dis = _mm_add_ps(_dis, _mm_mul_ps(e3, _mm_set1_ps((float)(l + 3))));
+        }
+
+        _mm_storeu_ps(ltrb, _mm_div_ps(_dis, _sum));
+        return;
+    }
+#endif // __ARM_NEON
+
+    for (int k = 0; k < 4; k++)
+    {
+        const float* p = bins + reg_max * k;
+
+        float max = -FLT_MAX;
+        for (int l = 0; l < reg_max; l++)
+        {
+            max = std::max(max, p[l]);
+        }
+
+        float sum = 0.f;
+        float dis = 0.f;
+        for (int l = 0; l < reg_max; l++)
+        {
+            float e = expf(p[l] - max);
+            sum += e;
+            dis += l * e;
+        }
+
+        ltrb[k] = dis / sum;
+    }
+}
+
+#endif // YOLO11DFL_H
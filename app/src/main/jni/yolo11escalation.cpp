@@ -0,0 +1,301 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2025 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "yolo11escalation.h"
+
+#include <algorithm>
+
+#include <benchmark.h>
+
+static inline float intersection_over_union(const cv::Rect_<float>& a, const cv::Rect_<float>& b)
+{
+    cv::Rect_<float> inter = a & b;
+    float inter_area = inter.area();
+    float union_area = a.area() + b.area() - inter_area;
+    return union_area > 0.f ? inter_area / union_area : 0.f;
+}
+
+static void offset_object(Object& obj, int ox, int oy)
+{
+    obj.rect.x += ox;
+    obj.rect.y += oy;
+    obj.rrect.center.x += ox;
+    obj.rrect.center.y += oy;
+
+    for (size_t k = 0; k < obj.keypoints.size(); k++)
+    {
+        obj.keypoints[k].p.x += ox;
+        obj.keypoints[k].p.y += oy;
+    }
+}
+
+static inline bool center_inside(const cv::Rect_<float>& rect, const cv::Rect& roi)
+{
+    const float cx = rect.x + rect.width * 0.5f;
+    const float cy = rect.y + rect.height * 0.5f;
+    return cx >= roi.x && cx < roi.x + roi.width && cy >= roi.y && cy < roi.y + roi.height;
+}
+
+// grow every rect by a quarter on each side for context, clip, and merge the ones that touch
+static void merge_regions(const std::vector<cv::Rect_<float> >& rects, int img_w, int img_h, std::vector<cv::Rect>& regions)
+{
+    regions.clear();
+
+    const cv::Rect frame(0, 0, img_w, img_h);
+    for (size_t i = 0; i < rects.size(); i++)
+    {
+        const cv::Rect_<float>& r = rects[i];
+        const float mx = r.width * 0.25f;
+        const float my = r.height * 0.25f;
+
+        cv::Rect region((int)(r.x - mx), (int)(r.y - my), (int)(r.width + mx * 2) + 1, (int)(r.height + my * 2) + 1);
+        region &= frame;
+        if (region.area() > 0)
+            regions.push_back(region);
+    }
+
+    bool merged = true;
+    while (merged)
+    {
+        merged = false;
+        for (size_t i = 0; i < regions.size() && !merged; i++)
+        {
+            for (size_t j = i + 1; j < regions.size(); j++)
+            {
+                if ((regions[i] & regions[j]).area() > 0)
+                {
+                    regions[i] |= regions[j];
+                    regions.erase(regions.begin() + j);
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+YOLO11Escalation::YOLO11Escalation(const std::shared_ptr<YOLO11>& _fast, const std::shared_ptr<YOLO11>& _accurate)
+    : fast(_fast), accurate(_accurate)
+{
+    band_low = 0.5f;
+    band_high = 0.9f;
+    max_region_coverage = 0.4f;
+
+    reset_stats();
+}
+
+void YOLO11Escalation::set_band(float low, float high)
+{
+    band_low = low;
+    band_high = std::max(low, high);
+}
+
+void YOLO11Escalation::set_prob_threshold(float prob_threshold)
+{
+    YOLO11_det* fast_det = dynamic_cast<YOLO11_det*>(fast.get());
+    if (fast_det)
+        fast_det->set_prob_threshold(prob_threshold);
+
+    YOLO11_det* accurate_det = dynamic_cast<YOLO11_det*>(accurate.get());
+    if (accurate_det)
+        accurate_det->set_prob_threshold(prob_threshold);
+}
+
+void YOLO11Escalation::set_max_region_coverage(float coverage)
+{
+    max_region_coverage = std::min(std::max(coverage, 0.f), 1.f);
+}
+
+bool YOLO11Escalation::is_ready() const
+{
+    return fast->is_ready() && accurate->is_ready();
+}
+
+int YOLO11Escalation::detect(const cv::Mat& rgb, std::vector<Object>& objects)
+{
+    double t0 = ncnn::get_current_time();
+
+    // det keeps nothing below its threshold, only escalated boxes may still rise above it
+    YOLO11_det* fast_det = dynamic_cast<YOLO11_det*>(fast.get());
+    const float prob_threshold = fast_det ? fast_det->get_prob_threshold() : 0.f;
+
+    // lowered on a borrowed context, the shared model keeps its threshold for everyone else
+    YOLO11Context* ctx = fast->acquire_context();
+    if (fast_det && band_low < prob_threshold)
+        ctx->prob_threshold = band_low;
+
+    fast->detect(rgb, objects, *ctx);
+
+    fast->release_context(ctx);
+
+    double t1 = ncnn::get_current_time();
+
+    std::vector<cv::Rect_<float> > unsure;
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+        if (objects[i].prob >= band_low && objects[i].prob < band_high)
+            unsure.push_back(objects[i].rect);
+    }
+
+    // the small model losing or relabelling a box it was sure of is worth a second look
+    for (size_t i = 0; i < tracks.size(); i++)
+    {
+        int best = -1;
+        float best_iou = 0.3f;
+        for (size_t j = 0; j < objects.size(); j++)
+        {
+            float iou = intersection_over_union(tracks[i].rect, objects[j].rect);
+            if (iou > best_iou)
+            {
+                best = (int)j;
+                best_iou = iou;
+            }
+        }
+
+        if (best == -1 || objects[best].label != tracks[i].label)
+            unsure.push_back(tracks[i].rect);
+    }
+
+    std::vector<cv::Rect> regions;
+    merge_regions(unsure, rgb.cols, rgb.rows, regions);
+
+    int covered = 0;
+    for (size_t i = 0; i < regions.size(); i++)
+    {
+        covered += regions[i].area();
+    }
+
+    const bool full = !regions.empty() && covered > max_region_coverage * rgb.cols * rgb.rows;
+
+    double accurate_latency = 0.0;
+    if (full)
+    {
+        double t2 = ncnn::get_current_time();
+        accurate->detect(rgb, objects);
+        double t3 = ncnn::get_current_time();
+
+        accurate_latency = t3 - t2;
+    }
+    else
+    {
+        for (size_t i = 0; i < regions.size(); i++)
+        {
+            const cv::Rect& roi = regions[i];
+
+            std::vector<Object> region_objects;
+            accurate->detect(rgb(roi), region_objects);
+
+            // the accurate model owns the region, boxes centered in it come from there
+            std::vector<Object> kept;
+            for (size_t j = 0; j < objects.size(); j++)
+            {
+                if (!center_inside(objects[j].rect, roi))
+                    kept.push_back(objects[j]);
+            }
+
+            for (size_t j = 0; j < region_objects.size(); j++)
+            {
+                offset_object(region_objects[j], roi.x, roi.y);
+
+                if (center_inside(region_objects[j].rect, roi))
+                    kept.push_back(region_objects[j]);
+            }
+
+            objects.swap(kept);
+        }
+    }
+
+    if (fast_det)
+    {
+        std::vector<Object> kept;
+        for (size_t i = 0; i < objects.size(); i++)
+        {
+            if (objects[i].prob >= prob_threshold)
+                kept.push_back(objects[i]);
+        }
+        objects.swap(kept);
+    }
+
+    double t4 = ncnn::get_current_time();
+
+    tracks.clear();
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+        if (objects[i].prob < band_high)
+            continue;
+
+        Track t;
+        t.rect = objects[i].rect;
+        t.label = objects[i].label;
+        tracks.push_back(t);
+    }
+
+    {
+        ncnn::MutexLockGuard g(stats_lock);
+
+        stats.frames++;
+        if (!regions.empty())
+            stats.escalated_frames++;
+        if (full)
+            stats.full_frames++;
+        else
+            stats.regions += (int)regions.size();
+
+        total_fast_latency += t1 - t0;
+        total_latency += t4 - t0;
+
+        if (full)
+            stats.accurate_latency = (float)accurate_latency;
+    }
+
+    return 0;
+}
+
+int YOLO11Escalation::draw(cv::Mat& rgb, const std::vector<Object>& objects)
+{
+    return fast->draw(rgb, objects);
+}
+
+EscalationStats YOLO11Escalation::get_stats() const
+{
+    ncnn::MutexLockGuard g(stats_lock);
+
+    EscalationStats s = stats;
+    if (s.frames > 0)
+    {
+        s.fast_latency = (float)(total_fast_latency / s.frames);
+        s.latency = (float)(total_latency / s.frames);
+    }
+
+    // no whole-frame escalation yet, the warm-up measured one
+    if (s.accurate_latency == 0.f)
+        s.accurate_latency = accurate->get_warm_latency();
+
+    return s;
+}
+
+void YOLO11Escalation::reset_stats()
+{
+    ncnn::MutexLockGuard g(stats_lock);
+
+    stats.frames = 0;
+    stats.escalated_frames = 0;
+    stats.full_frames = 0;
+    stats.regions = 0;
+    stats.fast_latency = 0.f;
+    stats.latency = 0.f;
+    stats.accurate_latency = 0.f;
+    total_fast_latency = 0.0;
+    total_latency = 0.0;
+}
@@ -0,0 +1,83 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2025 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef YOLO11ESCALATION_H
+#define YOLO11ESCALATION_H
+
+#include <memory>
+#include <vector>
+
+#include <platform.h>
+
+#include "yolo11.h"
+
+struct EscalationStats
+{
+    int frames;
+    int escalated_frames;   // frames that ran the accurate model at all
+    int full_frames;        // of those, frames rerun whole
+    int regions;            // regions rerun, summed over frames
+    float fast_latency;     // average milliseconds of the fast model per frame
+    float latency;          // average milliseconds per frame, fast model and escalations
+    float accurate_latency; // milliseconds of one whole-frame accurate detect, the per-frame cost of always running it
+};
+
+// run a small model on every frame and a larger one of the same task only where the small one is unsure
+// unsure means a score inside the ambiguity band, or a confident box of the last frame that vanished or changed class
+// the unsure regions are rerun with the accurate model, or the whole frame when they cover too much of it
+class YOLO11Escalation
+{
+public:
+    YOLO11Escalation(const std::shared_ptr<YOLO11>& fast, const std::shared_ptr<YOLO11>& accurate);
+
+    // fast detections scoring in [low, high) are ambiguous
+    // a det model is run down to low to find them, its output is still cut at its own threshold
+    void set_band(float low, float high);
+    // candidate threshold of both models when they are det, others keep their fixed one
+    void set_prob_threshold(float prob_threshold);
+    // regions covering more than this fraction of the frame rerun the whole frame, 0 always does
+    void set_max_region_coverage(float coverage);
+
+    bool is_ready() const;
+
+    int detect(const cv::Mat& rgb, std::vector<Object>& objects);
+    int draw(cv::Mat& rgb, const std::vector<Object>& objects);
+
+    EscalationStats get_stats() const;
+    void reset_stats();
+
+private:
+    struct Track
+    {
+        cv::Rect_<float> rect;
+        int label;
+    };
+
+    std::shared_ptr<YOLO11> fast;
+    std::shared_ptr<YOLO11> accurate;
+
+    float band_low;
+    float band_high;
+    float max_region_coverage;
+
+    // confident boxes of the last frame
+    std::vector<Track> tracks;
+
+    mutable ncnn::Mutex stats_lock;
+    EscalationStats stats;
+    double total_fast_latency;
+    double total_latency;
+};
+
+#endif // YOLO11ESCALATION_H
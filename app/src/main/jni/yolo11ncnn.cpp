@@ -20,13 +20,27 @@
 
 #include <jni.h>
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include <errno.h>
+#include <sys/stat.h>
+
 #include <platform.h>
 #include <benchmark.h>
+#include <cpu.h>
 
 #include "yolo11.h"
+#include "modelcache.h"
+#include "sizecontroller.h"
+#include "yolo11session.h"
+#include "yolo11cascade.h"
+#include "yolo11tiled.h"
+#include "yolo11escalation.h"
+#include "yolo11async.h"
 
 #include "ndkcamera.h"
 
@@ -110,39 +124,708 @@ static int draw_fps(cv::Mat& rgb)
     return 0;
 }
 
-static YOLO11* g_yolo11 = 0;
-static ncnn::Mutex lock;
+// the model being rendered, swapped atomically so the camera never waits for a load
+static std::shared_ptr<YOLO11> g_yolo11;
+
+// a second model on the same frame, rendered instead of g_yolo11 while set
+static std::shared_ptr<YOLO11Session> g_session;
+
+// det refined by a cls model on its crops, when the second model is a classifier
+static std::shared_ptr<YOLO11Cascade> g_cascade;
+
+// crops the cascade may classify per frame
+static std::atomic<int> g_cascade_crop_budget(8);
+
+// secondary model of the primary's task, escalated to where the primary is unsure
+static std::shared_ptr<YOLO11Escalation> g_escalation;
+static std::atomic<float> g_escalation_low(0.5f);
+static std::atomic<float> g_escalation_high(0.9f);
+static std::atomic<float> g_escalation_coverage(0.4f);
+
+// tiled detection for det, seg and obb models on frames larger than det_target_size
+static std::atomic<bool> g_tiled(false);
+static std::atomic<float> g_tiled_overlap(0.2f);
+static std::atomic<bool> g_yolo11_tileable(false);
+
+// det only, reruns the changed part of a mostly static frame, the cache belongs to the camera stream
+static std::atomic<bool> g_incremental(false);
+static ncnn::Mutex g_feature_cache_lock;
+static FeatureCache g_feature_cache;
+static std::weak_ptr<YOLO11> g_feature_cache_model;
+
+// detect on a worker fed with frame copies, the camera draws the newest finished result
+// built by the loader for g_yolo11, objects come from the model they were detected with
+static std::shared_ptr<YOLO11Async> g_async;
+static ncnn::Mutex g_async_lock;
+static std::weak_ptr<YOLO11> g_async_model;
+static std::vector<Object> g_async_objects;
+
+// candidate filter of det models, applied in the decode layer appended at load or on the cpu otherwise
+static std::atomic<float> g_det_prob_threshold(0.86f);
+static std::atomic<int> g_det_max_candidates(300);
+
+// odd while a frame holds a reference to g_yolo11, g_session or g_cascade
+// frames are only rendered on the camera callback thread, so one counter covers every reader
+static std::atomic<unsigned int> g_render_seq(0);
+
+// owns every loaded model, g_yolo11 is always its most recently used entry
+static ModelCache* g_modelcache = 0;
+static int g_gpu_driver = 0;
+
+// estimated weights of the models kept around for quick switching
+static const size_t model_cache_budget = 160 * 1024 * 1024;
+
+// dummy inferences run after a model or input size change
+static const int warmup_loop_count = 3;
+
+// trades det_target_size for frame rate when a detect latency budget is set
+// the camera thread feeds it, the loader thread is the only one setting det_target_size
+static SizeController g_sizecontroller;
+
+static void request_resize(const std::shared_ptr<YOLO11>& yolo11, int target_size);
 
 class MyNdkCamera : public NdkCameraWindow
 {
 public:
     virtual void on_image_render(cv::Mat& rgb) const;
+
+private:
+    // last rendered frame, shown again while a freshly loaded model warms up
+    mutable cv::Mat last_rgb;
 };
 
 void MyNdkCamera::on_image_render(cv::Mat& rgb) const
 {
+    bool warming = false;
+
     // yolo11
+    g_render_seq++;
     {
-        ncnn::MutexLockGuard g(lock);
+        std::shared_ptr<YOLO11Cascade> cascade = std::atomic_load(&g_cascade);
+        std::shared_ptr<YOLO11Escalation> escalation;
+        if (!cascade)
+            escalation = std::atomic_load(&g_escalation);
+        std::shared_ptr<YOLO11Session> session;
+        if (!cascade && !escalation)
+            session = std::atomic_load(&g_session);
+        std::shared_ptr<YOLO11> yolo11;
+        if (!cascade && !escalation && !session)
+            yolo11 = std::atomic_load(&g_yolo11);
+
+        if (cascade && !cascade->is_ready())
+        {
+            warming = true;
+        }
+        else if (cascade)
+        {
+            cascade->set_crop_budget(g_cascade_crop_budget);
 
-        if (g_yolo11)
+            std::vector<Object> objects;
+            cascade->detect(rgb, objects);
+
+            cascade->draw(rgb, objects);
+        }
+        else if (escalation && !escalation->is_ready())
+        {
+            warming = true;
+        }
+        else if (escalation)
         {
+            escalation->set_band(g_escalation_low, g_escalation_high);
+            escalation->set_prob_threshold(g_det_prob_threshold);
+            escalation->set_max_region_coverage(g_escalation_coverage);
+
             std::vector<Object> objects;
-            g_yolo11->detect(rgb, objects);
+            escalation->detect(rgb, objects);
 
-            g_yolo11->draw(rgb, objects);
+            escalation->draw(rgb, objects);
+        }
+        else if (session && !session->is_ready())
+        {
+            warming = true;
+        }
+        else if (session)
+        {
+            SessionResult result;
+            session->detect(rgb, result);
+
+            session->draw(rgb, result);
+        }
+        else if (yolo11 && !yolo11->is_ready())
+        {
+            warming = true;
+        }
+        else if (yolo11)
+        {
+            std::vector<Object> objects;
+
+            // smaller tiles mean more of them, the size controller only drives whole-frame detect
+            const bool tiled = g_tiled && g_yolo11_tileable;
+            std::shared_ptr<YOLO11Async> async = std::atomic_load(&g_async);
+            if (tiled || g_incremental || (async && async->get_model() != yolo11))
+                async.reset();
+            YOLO11_det* det = dynamic_cast<YOLO11_det*>(yolo11.get());
+            if (det)
+            {
+                det->set_prob_threshold(g_det_prob_threshold);
+                det->set_max_candidates(g_det_max_candidates);
+            }
+            if (!g_incremental || tiled)
+                det = 0;
+
+            double t0 = ncnn::get_current_time();
+            if (async)
+            {
+                // the camera reuses rgb, a busy worker lets the newer frame replace the queued one
+                std::weak_ptr<YOLO11> model = yolo11;
+                async->submit(rgb.clone(), [model](AsyncResult& result) {
+                    if (result.status != YOLO11Async::OK)
+                        return;
+
+                    ncnn::MutexLockGuard g(g_async_lock);
+                    g_async_model = model;
+                    g_async_objects.swap(result.objects);
+                });
+
+                ncnn::MutexLockGuard g(g_async_lock);
+                if (g_async_model.lock() == yolo11)
+                    objects = g_async_objects;
+            }
+            else if (tiled)
+            {
+                YOLO11Tiled tiled;
+                tiled.set_overlap(g_tiled_overlap);
+                tiled.detect(*yolo11, rgb, objects);
+            }
+            else if (det)
+            {
+                ncnn::MutexLockGuard g(g_feature_cache_lock);
+
+                if (g_feature_cache_model.lock() != yolo11)
+                {
+                    g_feature_cache.reset();
+                    g_feature_cache_model = yolo11;
+                }
+
+                det->detect_incremental(rgb, objects, g_feature_cache);
+            }
+            else
+            {
+                yolo11->detect(rgb, objects);
+            }
+            double t1 = ncnn::get_current_time();
+
+            yolo11->draw(rgb, objects);
+
+            // incremental latency follows the scene, not the input size, and cls always runs at 224
+            // async frames only measure the submit
+            const bool adaptive = !async && !tiled && !det && !dynamic_cast<YOLO11_cls*>(yolo11.get());
+            const int target_size = adaptive ? g_sizecontroller.update((float)(t1 - t0)) : yolo11->get_det_target_size();
+            if (target_size != yolo11->get_det_target_size())
+            {
+                request_resize(yolo11, target_size);
+            }
         }
         else
         {
             draw_unsupported(rgb);
         }
     }
+    g_render_seq++;
+
+    if (warming)
+    {
+        if (!last_rgb.empty() && last_rgb.rows == rgb.rows && last_rgb.cols == rgb.cols)
+        {
+            last_rgb.copyTo(rgb);
+        }
+        return;
+    }
 
     draw_fps(rgb);
+
+    rgb.copyTo(last_rgb);
 }
 
 static MyNdkCamera* g_camera = 0;
 
+struct LoadRequest
+{
+    AAssetManager* mgr;
+    ModelKey key;
+    int target_size;
+};
+
+// model loads run here, one at a time, the newest request replaces a pending one
+static ncnn::Thread* g_loader_thread = 0;
+static ncnn::Mutex g_loader_lock;
+static ncnn::ConditionVariable g_loader_condition;
+static bool g_loader_quit = false;
+static bool g_load_pending = false;
+static LoadRequest g_load_request;
+static bool g_preload_pending = false;
+static LoadRequest g_preload_request;
+static bool g_secondary_pending = false;
+static LoadRequest g_secondary_request;
+static bool g_class_subset_pending = false;
+static std::vector<int> g_class_subset_request;
+static bool g_trim_pending = false;
+static int g_trim_level = 0;
+static bool g_budget_pending = false;
+static size_t g_budget_request = 0;
+static bool g_resize_pending = false;
+static std::weak_ptr<YOLO11> g_resize_model;
+static int g_resize_request = 0;
+static bool g_label_map_pending = false;
+static std::vector<int> g_label_map_request;
+static bool g_async_pending = false;
+static bool g_async_request = false;
+
+// classes kept in the heads of det seg pose and obb models, empty keeps all, only touched by the loader
+static std::vector<int> g_class_subset;
+
+// g_yolo11 detects through g_async, only touched by the loader
+static bool g_async_detect = false;
+
+// cls label to det label for the cascade, empty runs det and cls side by side, only touched by the loader
+static std::vector<int> g_cascade_label_map;
+
+// the loader's view of what g_yolo11 points to
+static bool g_yolo11_on_gpu = false;
+static int g_yolo11_taskid = -1;
+
+// paired with g_yolo11 into g_session or g_cascade, only touched by the loader
+static std::shared_ptr<YOLO11> g_secondary;
+static bool g_secondary_on_gpu = false;
+static int g_secondary_taskid = -1;
+
+// the loader sets it so it is never changed under obtain_model or a warm-up
+static void request_resize(const std::shared_ptr<YOLO11>& yolo11, int target_size)
+{
+    ncnn::MutexLockGuard g(g_loader_lock);
+
+    g_resize_model = yolo11;
+    g_resize_request = target_size;
+    g_resize_pending = true;
+    g_loader_condition.signal();
+}
+
+// wait for the frame that may have picked up the previous g_yolo11 to finish
+// relies on g_render_seq having the camera thread as its only writer, a second rendering thread needs a reader count
+static void wait_render_grace()
+{
+    const unsigned int seq = g_render_seq;
+    if (seq % 2 == 0)
+        return;
+
+    while (g_render_seq == seq)
+    {
+        ncnn::sleep(1);
+    }
+}
+
+// rebuild g_async for g_yolo11, or drop it
+// the retired front-end joins its worker here, so no frame still runs on a model about to be released
+static void publish_async()
+{
+    std::shared_ptr<YOLO11Async> async;
+
+    std::shared_ptr<YOLO11> yolo11 = std::atomic_load(&g_yolo11);
+    if (yolo11 && g_async_detect)
+    {
+        // one worker and one queued frame, the camera never waits
+        async = std::make_shared<YOLO11Async>(yolo11, 1, 1, YOLO11Async::DROP_OLDEST);
+    }
+
+    std::shared_ptr<YOLO11Async> retired = std::atomic_exchange(&g_async, async);
+
+    wait_render_grace();
+
+    retired.reset();
+
+    ncnn::MutexLockGuard g(g_async_lock);
+    g_async_model.reset();
+    g_async_objects.clear();
+}
+
+// make yolo11 the rendered model, the old one is released here and not on the camera thread
+static void publish_model(const std::shared_ptr<YOLO11>& yolo11, bool on_gpu, int taskid)
+{
+    // det seg obb
+    g_yolo11_tileable = taskid == 0 || taskid == 1 || taskid == 4;
+
+    std::shared_ptr<YOLO11> retired = std::atomic_exchange(&g_yolo11, yolo11);
+    g_yolo11_on_gpu = on_gpu;
+    g_yolo11_taskid = taskid;
+
+    wait_render_grace();
+
+    publish_async();
+}
+
+// pair g_yolo11 with g_secondary, or stop rendering a session when either is missing
+// det with a classifier becomes a cascade, a full-frame cls pass tells nothing about the boxes
+// two models of one task escalate from the primary to the secondary
+static void publish_session()
+{
+    std::shared_ptr<YOLO11Session> session;
+    std::shared_ptr<YOLO11Cascade> cascade;
+    std::shared_ptr<YOLO11Escalation> escalation;
+
+    std::shared_ptr<YOLO11> yolo11 = std::atomic_load(&g_yolo11);
+    // the cls labels mean nothing to det without a map from the caller
+    if (yolo11 && g_secondary && g_yolo11_taskid == 0 && g_secondary_taskid == 3 && !g_cascade_label_map.empty())
+    {
+        cascade = std::make_shared<YOLO11Cascade>(yolo11, g_secondary);
+        cascade->set_label_map(g_cascade_label_map);
+    }
+    else if (yolo11 && g_secondary && g_yolo11_taskid == g_secondary_taskid && g_yolo11_taskid != 3)
+    {
+        escalation = std::make_shared<YOLO11Escalation>(yolo11, g_secondary);
+    }
+    else if (yolo11 && g_secondary)
+    {
+        session = std::make_shared<YOLO11Session>();
+        session->add(yolo11);
+        session->add(g_secondary);
+    }
+
+    std::shared_ptr<YOLO11Cascade> retired_cascade = std::atomic_exchange(&g_cascade, cascade);
+    std::shared_ptr<YOLO11Escalation> retired_escalation = std::atomic_exchange(&g_escalation, escalation);
+    std::shared_ptr<YOLO11Session> retired_session = std::atomic_exchange(&g_session, session);
+
+    wait_render_grace();
+}
+
+static void switch_gpu_driver(int driver)
+{
+    // models on the old vulkan instance die with it, cpu models stay cached
+    if (g_yolo11_on_gpu)
+    {
+        publish_model(std::shared_ptr<YOLO11>(), false, -1);
+    }
+
+    if (g_secondary_on_gpu)
+    {
+        g_secondary.reset();
+        g_secondary_on_gpu = false;
+        g_secondary_taskid = -1;
+    }
+
+    publish_session();
+
+    g_modelcache->wait_preload();
+    g_modelcache->evict_gpu();
+
+    ncnn::destroy_gpu_instance();
+
+    if (driver == 2)
+    {
+        ncnn::create_gpu_instance("libvulkan_freedreno.so");
+    }
+    else
+    {
+        ncnn::create_gpu_instance();
+    }
+
+    g_gpu_driver = driver;
+}
+
+// cached or freshly loaded model for request, warmed up at its target size
+static std::shared_ptr<YOLO11> obtain_model(const LoadRequest& request, bool& loaded)
+{
+    const ModelKey& key = request.key;
+
+    if (key.backend != 0 && key.backend != g_gpu_driver)
+    {
+        switch_gpu_driver(key.backend);
+    }
+
+    std::shared_ptr<YOLO11> yolo11 = g_modelcache->get(key);
+    if (!yolo11)
+    {
+        // it may be on its way in from a preload
+        g_modelcache->wait_preload();
+        yolo11 = g_modelcache->get(key);
+    }
+
+    loaded = false;
+    if (!yolo11)
+    {
+        yolo11.reset(ModelCache::create(request.mgr, key));
+        if (!yolo11)
+            return yolo11;
+
+        loaded = true;
+    }
+
+    // the rendered models follow the subset in apply_class_subset, any other may be rebuilt here
+    bool rebuilt = false;
+    if (key.taskid != 3 && yolo11->get_class_subset() != g_class_subset && yolo11 != std::atomic_load(&g_yolo11) && yolo11 != g_secondary)
+    {
+        yolo11->set_class_subset(g_class_subset);
+        if (yolo11->reload() != 0)
+            __android_log_print(ANDROID_LOG_WARN, "ncnn", "class subset reload failed");
+
+        rebuilt = true;
+    }
+
+    if (loaded || rebuilt || request.target_size != yolo11->get_det_target_size())
+    {
+        yolo11->set_det_target_size(request.target_size);
+
+        // first detects on a new model or input size are several times slower, pay for them before publishing
+        yolo11->warmup(warmup_loop_count);
+    }
+
+    return yolo11;
+}
+
+static void load_model(const LoadRequest& request)
+{
+    const ModelKey& key = request.key;
+
+    bool loaded = false;
+    std::shared_ptr<YOLO11> yolo11 = obtain_model(request, loaded);
+    if (!yolo11)
+    {
+        publish_model(std::shared_ptr<YOLO11>(), false, -1);
+        publish_session();
+        return;
+    }
+
+    g_sizecontroller.reset(request.target_size);
+
+    publish_model(yolo11, key.backend != 0, key.taskid);
+    publish_session();
+
+    if (loaded)
+    {
+        // may evict the retired model, which no frame references any more
+        g_modelcache->put(key, yolo11);
+    }
+}
+
+static void load_secondary_model(const LoadRequest& request)
+{
+    const ModelKey& key = request.key;
+
+    // taskid -1 goes back to the single model
+    if (key.taskid == -1)
+    {
+        g_secondary.reset();
+        g_secondary_on_gpu = false;
+        g_secondary_taskid = -1;
+        publish_session();
+        return;
+    }
+
+    bool loaded = false;
+    std::shared_ptr<YOLO11> yolo11 = obtain_model(request, loaded);
+
+    // a driver switch for it may have dropped the primary model, it is then reloaded by the next loadModel
+    g_secondary = yolo11;
+    g_secondary_on_gpu = yolo11 && key.backend != 0;
+    g_secondary_taskid = yolo11 ? key.taskid : -1;
+    publish_session();
+
+    if (loaded)
+    {
+        g_modelcache->put(key, yolo11);
+    }
+}
+
+static bool needs_class_subset(const std::shared_ptr<YOLO11>& yolo11, int taskid)
+{
+    return yolo11 && taskid != 3 && yolo11->get_class_subset() != g_class_subset;
+}
+
+static bool rebuild_for_class_subset(const std::shared_ptr<YOLO11>& yolo11, int taskid)
+{
+    if (!needs_class_subset(yolo11, taskid))
+        return true;
+
+    yolo11->set_class_subset(g_class_subset);
+    if (yolo11->reload() != 0)
+        return false;
+
+    yolo11->warmup(warmup_loop_count);
+
+    return true;
+}
+
+// cut the heads of the rendered models to the new subset, from the weights they keep mapped
+static void apply_class_subset(const std::vector<int>& classes)
+{
+    g_class_subset = classes;
+
+    std::shared_ptr<YOLO11> yolo11 = std::atomic_load(&g_yolo11);
+    const bool on_gpu = g_yolo11_on_gpu;
+    const int taskid = g_yolo11_taskid;
+
+    // the models stay published but warming, frames show the last one until warmup marks them ready
+    // the async worker detects off the render path, it is stopped until the rebuild is done
+    if (needs_class_subset(yolo11, taskid))
+        yolo11->set_warming();
+    if (needs_class_subset(g_secondary, g_secondary_taskid))
+        g_secondary->set_warming();
+
+    std::shared_ptr<YOLO11Async> retired_async = std::atomic_exchange(&g_async, std::shared_ptr<YOLO11Async>());
+
+    wait_render_grace();
+
+    retired_async.reset();
+
+    if (!rebuild_for_class_subset(yolo11, taskid))
+    {
+        __android_log_print(ANDROID_LOG_WARN, "ncnn", "class subset reload failed");
+        yolo11.reset();
+    }
+
+    if (!rebuild_for_class_subset(g_secondary, g_secondary_taskid))
+    {
+        g_secondary.reset();
+        g_secondary_on_gpu = false;
+        g_secondary_taskid = -1;
+    }
+
+    {
+        ncnn::MutexLockGuard g(g_feature_cache_lock);
+
+        g_feature_cache.reset();
+    }
+
+    publish_model(yolo11, yolo11 && on_gpu, yolo11 ? taskid : -1);
+    publish_session();
+}
+
+static void preload_model(const LoadRequest& request)
+{
+    const ModelKey& key = request.key;
+
+    // only models for the current vulkan instance can be prepared ahead
+    if (key.backend != 0 && key.backend != g_gpu_driver)
+    {
+        __android_log_print(ANDROID_LOG_DEBUG, "ncnn", "skip preload on another gpu driver");
+        return;
+    }
+
+    g_modelcache->preload(request.mgr, key);
+}
+
+static void* loader_entry(void* args)
+{
+    for (;;)
+    {
+        bool load = false;
+        bool preload = false;
+        bool secondary = false;
+        bool class_subset = false;
+        std::vector<int> classes;
+        bool trim = false;
+        int trim_level = 0;
+        bool budget = false;
+        size_t budget_bytes = 0;
+        bool resize = false;
+        std::shared_ptr<YOLO11> resize_model;
+        int resize_target = 0;
+        bool label_map = false;
+        std::vector<int> label_map_request;
+        bool async = false;
+        bool async_request = false;
+        LoadRequest request;
+        LoadRequest preload_request;
+        LoadRequest secondary_request;
+
+        {
+            ncnn::MutexLockGuard g(g_loader_lock);
+
+            while (!g_loader_quit && !g_load_pending && !g_preload_pending && !g_secondary_pending && !g_class_subset_pending && !g_trim_pending && !g_budget_pending && !g_resize_pending && !g_label_map_pending && !g_async_pending)
+            {
+                g_loader_condition.wait(g_loader_lock);
+            }
+
+            if (g_loader_quit)
+                break;
+
+            load = g_load_pending;
+            request = g_load_request;
+            g_load_pending = false;
+
+            preload = g_preload_pending;
+            preload_request = g_preload_request;
+            g_preload_pending = false;
+
+            secondary = g_secondary_pending;
+            secondary_request = g_secondary_request;
+            g_secondary_pending = false;
+
+            class_subset = g_class_subset_pending;
+            classes = g_class_subset_request;
+            g_class_subset_pending = false;
+
+            trim = g_trim_pending;
+            trim_level = g_trim_level;
+            g_trim_pending = false;
+
+            budget = g_budget_pending;
+            budget_bytes = g_budget_request;
+            g_budget_pending = false;
+
+            resize = g_resize_pending;
+            resize_model = g_resize_model.lock();
+            resize_target = g_resize_request;
+            g_resize_pending = false;
+            g_resize_model.reset();
+
+            label_map = g_label_map_pending;
+            label_map_request = g_label_map_request;
+            g_label_map_pending = false;
+
+            async = g_async_pending;
+            async_request = g_async_request;
+            g_async_pending = false;
+        }
+
+        // a load in the same round resets the controller, only the model it was measured on is resized
+        if (resize && resize_model && resize_model == std::atomic_load(&g_yolo11))
+            resize_model->set_det_target_size(resize_target);
+
+        // the cache lets go of evicted models here and not on the ui thread
+        if (budget)
+            g_modelcache->set_budget(budget_bytes);
+
+        if (trim)
+            g_modelcache->trim(trim_level);
+
+        if (class_subset)
+            apply_class_subset(classes);
+
+        if (async)
+        {
+            g_async_detect = async_request;
+            publish_async();
+        }
+
+        if (label_map)
+        {
+            g_cascade_label_map = label_map_request;
+            publish_session();
+        }
+
+        if (load)
+            load_model(request);
+
+        if (secondary)
+            load_secondary_model(secondary_request);
+
+        if (preload)
+            preload_model(preload_request);
+    }
+
+    return 0;
+}
+
 extern "C" {
 
 JNIEXPORT jint JNI_OnLoad(JavaVM* vm, void* reserved)
@@ -151,7 +834,14 @@ JNIEXPORT jint JNI_OnLoad(JavaVM* vm, void* reserved)
 
     g_camera = new MyNdkCamera;
 
+    g_modelcache = new ModelCache;
+    g_modelcache->set_budget(model_cache_budget);
+
     ncnn::create_gpu_instance();
+    g_gpu_driver = 1;
+
+    g_loader_quit = false;
+    g_loader_thread = new ncnn::Thread(loader_entry);
 
     return JNI_VERSION_1_4;
 }
@@ -161,108 +851,418 @@ JNIEXPORT void JNI_OnUnload(JavaVM* vm, void* reserved)
     __android_log_print(ANDROID_LOG_DEBUG, "ncnn", "JNI_OnUnload");
 
     {
-        ncnn::MutexLockGuard g(lock);
+        ncnn::MutexLockGuard g(g_loader_lock);
 
-        delete g_yolo11;
-        g_yolo11 = 0;
+        g_loader_quit = true;
+        g_loader_condition.signal();
     }
 
+    g_loader_thread->join();
+    delete g_loader_thread;
+    g_loader_thread = 0;
+
+    g_secondary.reset();
+    publish_model(std::shared_ptr<YOLO11>(), false, -1);
+    publish_session();
+
+    delete g_modelcache;
+    g_modelcache = 0;
+
     ncnn::destroy_gpu_instance();
 
     delete g_camera;
     g_camera = 0;
 }
 
+static bool resolve_model_key(AAssetManager* mgr, jint taskid, jint modelid, jint cpugpu, ModelKey& key, int& target_size)
+{
+    if (taskid < 0 || taskid > 4 || modelid < 0 || modelid > 17 || cpugpu < 0 || cpugpu > 2)
+    {
+        return false;
+    }
+
+    // modelid 9~17 select the int8 quantized variants of 0~8
+    const bool use_int8 = (int)modelid >= 9;
+    const int sizeid = (int)modelid % 9;
+
+    key.taskid = (int)taskid;
+    key.modeltype = sizeid % 3;
+    key.use_int8 = use_int8;
+    key.backend = (int)cpugpu;
+
+    if (use_int8 && !ModelCache::has_assets(mgr, key))
+    {
+        // tools/yolo11_int8.py writes the int8 files, builds without them run the fp32 model
+        __android_log_print(ANDROID_LOG_WARN, "ncnn", "int8 model not packaged, using fp32");
+        key.use_int8 = false;
+    }
+
+    if (key.use_int8 && key.backend != 0)
+    {
+        // int8 layers have no vulkan implementation, keep quantized models on cpu
+        __android_log_print(ANDROID_LOG_WARN, "ncnn", "int8 model runs on cpu");
+        key.backend = 0;
+    }
+
+    target_size = 320;
+    if (sizeid >= 3)
+        target_size = 480;
+    if (sizeid >= 6)
+        target_size = 640;
+
+    return true;
+}
+
 // public native boolean loadModel(AssetManager mgr, int taskid, int modelid, int cpugpu);
 JNIEXPORT jboolean JNICALL Java_com_tencent_yolo11ncnn_YOLO11Ncnn_loadModel(JNIEnv* env, jobject thiz, jobject assetManager, jint taskid, jint modelid, jint cpugpu)
 {
-    if (taskid < 0 || taskid > 4 || modelid < 0 || modelid > 8 || cpugpu < 0 || cpugpu > 2)
+    LoadRequest request;
+    request.mgr = AAssetManager_fromJava(env, assetManager);
+    if (!resolve_model_key(request.mgr, taskid, modelid, cpugpu, request.key, request.target_size))
     {
         return JNI_FALSE;
     }
 
-    AAssetManager* mgr = AAssetManager_fromJava(env, assetManager);
+    __android_log_print(ANDROID_LOG_DEBUG, "ncnn", "loadModel %p", request.mgr);
+
+    // the current model keeps rendering until the new one is loaded and warm
+    {
+        ncnn::MutexLockGuard g(g_loader_lock);
+
+        g_load_request = request;
+        g_load_pending = true;
+        g_loader_condition.signal();
+    }
+
+    return JNI_TRUE;
+}
+
+// public native boolean loadSecondaryModel(AssetManager mgr, int taskid, int modelid, int cpugpu);
+JNIEXPORT jboolean JNICALL Java_com_tencent_yolo11ncnn_YOLO11Ncnn_loadSecondaryModel(JNIEnv* env, jobject thiz, jobject assetManager, jint taskid, jint modelid, jint cpugpu)
+{
+    LoadRequest request;
+    request.key.taskid = -1;
+    request.target_size = 320;
+    request.mgr = AAssetManager_fromJava(env, assetManager);
+    if (taskid != -1 && !resolve_model_key(request.mgr, taskid, modelid, cpugpu, request.key, request.target_size))
+    {
+        return JNI_FALSE;
+    }
 
-    __android_log_print(ANDROID_LOG_DEBUG, "ncnn", "loadModel %p", mgr);
+    __android_log_print(ANDROID_LOG_DEBUG, "ncnn", "loadSecondaryModel %d %d %d", (int)taskid, (int)modelid, (int)cpugpu);
 
-    const char* tasknames[5] =
+    // runs on the same frame as the loadModel one, sharing its letterbox when the sizes match
     {
-        "",
-        "_seg",
-        "_pose",
-        "_cls",
-        "_obb"
-    };
+        ncnn::MutexLockGuard g(g_loader_lock);
+
+        g_secondary_request = request;
+        g_secondary_pending = true;
+        g_loader_condition.signal();
+    }
+
+    return JNI_TRUE;
+}
+
+// public native boolean setCascadeCropBudget(int crops);
+JNIEXPORT jboolean JNICALL Java_com_tencent_yolo11ncnn_YOLO11Ncnn_setCascadeCropBudget(JNIEnv* env, jobject thiz, jint crops)
+{
+    if (crops < 0)
+        return JNI_FALSE;
+
+    g_cascade_crop_budget = (int)crops;
+
+    return JNI_TRUE;
+}
 
-    const char* modeltypes[9] =
+// public native boolean setCascadeLabelMap(int[] map);
+JNIEXPORT jboolean JNICALL Java_com_tencent_yolo11ncnn_YOLO11Ncnn_setCascadeLabelMap(JNIEnv* env, jobject thiz, jintArray map)
+{
+    std::vector<int> label_map;
+    if (map)
     {
-        "n",
-        "s",
-        "m",
-        "n",
-        "s",
-        "m",
-        "n",
-        "s",
-        "m"
-    };
+        label_map.resize(env->GetArrayLength(map));
+        if (!label_map.empty())
+            env->GetIntArrayRegion(map, 0, (jsize)label_map.size(), (jint*)&label_map[0]);
+    }
 
-    std::string parampath = std::string("yolo11") + modeltypes[(int)modelid] + tasknames[(int)taskid] + ".ncnn.param";
-    std::string modelpath = std::string("yolo11") + modeltypes[(int)modelid] + tasknames[(int)taskid] + ".ncnn.bin";
-    bool use_gpu = (int)cpugpu == 1;
-    bool use_turnip = (int)cpugpu == 2;
+    for (size_t i = 0; i < label_map.size(); i++)
+    {
+        if (label_map[i] < -1)
+            return JNI_FALSE;
+    }
 
-    // reload
+    // applied by the loader, an empty map drops the cascade
     {
-        ncnn::MutexLockGuard g(lock);
+        ncnn::MutexLockGuard g(g_loader_lock);
 
-        {
-            static int old_taskid = 0;
-            static int old_modelid = 0;
-            static int old_cpugpu = 0;
-            if (taskid != old_taskid || (modelid % 3) != old_modelid || cpugpu != old_cpugpu)
-            {
-                // taskid or model or cpugpu changed
-                delete g_yolo11;
-                g_yolo11 = 0;
-            }
-            old_taskid = taskid;
-            old_modelid = modelid % 3;
-            old_cpugpu = cpugpu;
+        g_label_map_request = label_map;
+        g_label_map_pending = true;
+        g_loader_condition.signal();
+    }
 
-            ncnn::destroy_gpu_instance();
+    return JNI_TRUE;
+}
 
-            if (use_turnip)
-            {
-                ncnn::create_gpu_instance("libvulkan_freedreno.so");
-            }
-            else if (use_gpu)
-            {
-                ncnn::create_gpu_instance();
-            }
+// public native boolean setEscalation(float low, float high, float coverage);
+JNIEXPORT jboolean JNICALL Java_com_tencent_yolo11ncnn_YOLO11Ncnn_setEscalation(JNIEnv* env, jobject thiz, jfloat low, jfloat high, jfloat coverage)
+{
+    if (low < 0.f || high < low || coverage < 0.f || coverage > 1.f)
+        return JNI_FALSE;
 
-            if (!g_yolo11)
-            {
-                if (taskid == 0) g_yolo11 = new YOLO11_det;
-                if (taskid == 1) g_yolo11 = new YOLO11_seg;
-                if (taskid == 2) g_yolo11 = new YOLO11_pose;
-                if (taskid == 3) g_yolo11 = new YOLO11_cls;
-                if (taskid == 4) g_yolo11 = new YOLO11_obb;
+    // det output is cut at its threshold, a band below it only escalates boxes that never show
+    if (high < g_det_prob_threshold)
+        return JNI_FALSE;
 
-                g_yolo11->load(mgr, parampath.c_str(), modelpath.c_str(), use_gpu || use_turnip);
-            }
-            int target_size = 320;
-            if ((int)modelid >= 3)
-                target_size = 480;
-            if ((int)modelid >= 6)
-                target_size = 640;
-            g_yolo11->set_det_target_size(target_size);
-        }
+    g_escalation_low = low;
+    g_escalation_high = high;
+    g_escalation_coverage = coverage;
+
+    return JNI_TRUE;
+}
+
+// public native String getEscalationStats();
+JNIEXPORT jstring JNICALL Java_com_tencent_yolo11ncnn_YOLO11Ncnn_getEscalationStats(JNIEnv* env, jobject thiz)
+{
+    std::shared_ptr<YOLO11Escalation> escalation = std::atomic_load(&g_escalation);
+    if (!escalation)
+        return env->NewStringUTF("");
+
+    EscalationStats stats = escalation->get_stats();
+
+    const float rate = stats.frames ? (float)stats.escalated_frames / stats.frames : 0.f;
+    const float saving = stats.accurate_latency > 0.f ? 1.f - stats.latency / stats.accurate_latency : 0.f;
+
+    char text[256];
+    sprintf(text, "escalation %d frames rate %.3f full %d regions %d\nfast %.2fms cascade %.2fms always accurate %.2fms saving %.1f%%",
+            stats.frames, rate, stats.full_frames, stats.regions, stats.fast_latency, stats.latency, stats.accurate_latency, saving * 100);
+
+    return env->NewStringUTF(text);
+}
+
+// public native boolean setTiled(boolean enable, float overlap);
+JNIEXPORT jboolean JNICALL Java_com_tencent_yolo11ncnn_YOLO11Ncnn_setTiled(JNIEnv* env, jobject thiz, jboolean enable, jfloat overlap)
+{
+    if (overlap < 0.f || overlap >= 1.f)
+        return JNI_FALSE;
+
+    __android_log_print(ANDROID_LOG_DEBUG, "ncnn", "setTiled %d %.2f", (int)enable, overlap);
+
+    g_tiled_overlap = (float)overlap;
+    g_tiled = enable;
+
+    return JNI_TRUE;
+}
+
+// public native boolean setAsyncDetect(boolean enable);
+JNIEXPORT jboolean JNICALL Java_com_tencent_yolo11ncnn_YOLO11Ncnn_setAsyncDetect(JNIEnv* env, jobject thiz, jboolean enable)
+{
+    // applied by the loader, it owns the worker
+    {
+        ncnn::MutexLockGuard g(g_loader_lock);
+
+        g_async_request = enable;
+        g_async_pending = true;
+        g_loader_condition.signal();
+    }
+
+    return JNI_TRUE;
+}
+
+// public native boolean setIncremental(boolean enable, float threshold, float coverage);
+JNIEXPORT jboolean JNICALL Java_com_tencent_yolo11ncnn_YOLO11Ncnn_setIncremental(JNIEnv* env, jobject thiz, jboolean enable, jfloat threshold, jfloat coverage)
+{
+    if (threshold < 0.f || coverage < 0.f || coverage > 1.f)
+        return JNI_FALSE;
+
+    {
+        ncnn::MutexLockGuard g(g_feature_cache_lock);
+
+        g_feature_cache.change_threshold = threshold;
+        g_feature_cache.max_coverage = coverage;
+        g_feature_cache.reset();
     }
 
+    g_incremental = enable;
+
     return JNI_TRUE;
 }
 
+// public native boolean setClassSubset(int[] classes);
+JNIEXPORT jboolean JNICALL Java_com_tencent_yolo11ncnn_YOLO11Ncnn_setClassSubset(JNIEnv* env, jobject thiz, jintArray classes)
+{
+    std::vector<int> subset;
+    if (classes)
+    {
+        subset.resize(env->GetArrayLength(classes));
+        if (!subset.empty())
+            env->GetIntArrayRegion(classes, 0, (jsize)subset.size(), (jint*)&subset[0]);
+    }
+
+    for (size_t i = 0; i < subset.size(); i++)
+    {
+        if (subset[i] < 0 || std::count(subset.begin(), subset.end(), subset[i]) != 1)
+            return JNI_FALSE;
+    }
+
+    // applied by the loader, the models are rebuilt from their mapped weights without reading the files
+    {
+        ncnn::MutexLockGuard g(g_loader_lock);
+
+        g_class_subset_request = subset;
+        g_class_subset_pending = true;
+        g_loader_condition.signal();
+    }
+
+    return JNI_TRUE;
+}
+
+// public native boolean setDetectFilter(float probThreshold, int maxCandidates);
+JNIEXPORT jboolean JNICALL Java_com_tencent_yolo11ncnn_YOLO11Ncnn_setDetectFilter(JNIEnv* env, jobject thiz, jfloat prob_threshold, jint max_candidates)
+{
+    if (prob_threshold <= 0.f || prob_threshold >= 1.f || max_candidates < 1)
+        return JNI_FALSE;
+
+    g_det_prob_threshold = prob_threshold;
+    g_det_max_candidates = max_candidates;
+
+    return JNI_TRUE;
+}
+
+// public native String getIncrementalStats();
+JNIEXPORT jstring JNICALL Java_com_tencent_yolo11ncnn_YOLO11Ncnn_getIncrementalStats(JNIEnv* env, jobject thiz)
+{
+    char text[256];
+
+    {
+        ncnn::MutexLockGuard g(g_feature_cache_lock);
+
+        const FeatureCache& cache = g_feature_cache;
+        const float coverage = cache.incremental_frames ? cache.coverage_sum / cache.incremental_frames : 0.f;
+
+        sprintf(text, "incremental %d frames full %d incremental %d unchanged %d coverage %.3f\nparity %d checks mismatches %d max diff %.5f",
+                cache.frames, cache.full_frames, cache.incremental_frames, cache.unchanged_frames, coverage, cache.parity_checks, cache.parity_mismatches, cache.parity_max_diff);
+    }
+
+    return env->NewStringUTF(text);
+}
+
+// public native boolean preloadModel(AssetManager mgr, int taskid, int modelid, int cpugpu);
+JNIEXPORT jboolean JNICALL Java_com_tencent_yolo11ncnn_YOLO11Ncnn_preloadModel(JNIEnv* env, jobject thiz, jobject assetManager, jint taskid, jint modelid, jint cpugpu)
+{
+    LoadRequest request;
+    request.mgr = AAssetManager_fromJava(env, assetManager);
+    if (!resolve_model_key(request.mgr, taskid, modelid, cpugpu, request.key, request.target_size))
+    {
+        return JNI_FALSE;
+    }
+
+    __android_log_print(ANDROID_LOG_DEBUG, "ncnn", "preloadModel %d %d %d", (int)taskid, (int)modelid, (int)cpugpu);
+
+    // the camera keeps running while the model loads
+    {
+        ncnn::MutexLockGuard g(g_loader_lock);
+
+        g_preload_request = request;
+        g_preload_pending = true;
+        g_loader_condition.signal();
+    }
+
+    return JNI_TRUE;
+}
+
+// public native boolean setModelCacheBudget(int megabytes);
+JNIEXPORT jboolean JNICALL Java_com_tencent_yolo11ncnn_YOLO11Ncnn_setModelCacheBudget(JNIEnv* env, jobject thiz, jint megabytes)
+{
+    if (megabytes < 0)
+        return JNI_FALSE;
+
+    // applied by the loader, which owns every model the cache destroys
+    {
+        ncnn::MutexLockGuard g(g_loader_lock);
+
+        g_budget_request = (size_t)megabytes * 1024 * 1024;
+        g_budget_pending = true;
+        g_loader_condition.signal();
+    }
+
+    return JNI_TRUE;
+}
+
+// public native boolean setRewriteCacheDir(String dir);
+JNIEXPORT jboolean JNICALL Java_com_tencent_yolo11ncnn_YOLO11Ncnn_setRewriteCacheDir(JNIEnv* env, jobject thiz, jstring dir)
+{
+    const char* path = env->GetStringUTFChars(dir, 0);
+    std::string cache_dir = path;
+    env->ReleaseStringUTFChars(dir, path);
+
+    if (!cache_dir.empty() && mkdir(cache_dir.c_str(), 0700) != 0 && errno != EEXIST)
+    {
+        __android_log_print(ANDROID_LOG_WARN, "ncnn", "rewrite cache %s unavailable", cache_dir.c_str());
+        return JNI_FALSE;
+    }
+
+    // models loaded from now on read and fill the cache
+    ModelCache::set_rewrite_cache_dir(cache_dir);
+
+    return JNI_TRUE;
+}
+
+// public native boolean trimMemory(int level);
+JNIEXPORT jboolean JNICALL Java_com_tencent_yolo11ncnn_YOLO11Ncnn_trimMemory(JNIEnv* env, jobject thiz, jint level)
+{
+    __android_log_print(ANDROID_LOG_DEBUG, "ncnn", "trimMemory %d", (int)level);
+
+    // applied by the loader, the strongest level wins when several arrive before it wakes
+    {
+        ncnn::MutexLockGuard g(g_loader_lock);
+
+        g_trim_level = g_trim_pending ? std::max(g_trim_level, (int)level) : (int)level;
+        g_trim_pending = true;
+        g_loader_condition.signal();
+    }
+
+    return JNI_TRUE;
+}
+
+// public native boolean setAdaptiveSize(float budgetms, int minsize, int maxsize);
+JNIEXPORT jboolean JNICALL Java_com_tencent_yolo11ncnn_YOLO11Ncnn_setAdaptiveSize(JNIEnv* env, jobject thiz, jfloat budgetms, jint minsize, jint maxsize)
+{
+    if (budgetms < 0.f || minsize < 32 || maxsize < minsize)
+        return JNI_FALSE;
+
+    __android_log_print(ANDROID_LOG_DEBUG, "ncnn", "setAdaptiveSize %.2fms %d %d", budgetms, (int)minsize, (int)maxsize);
+
+    g_sizecontroller.set_bounds((int)minsize, (int)maxsize);
+    g_sizecontroller.set_budget((float)budgetms);
+
+    return JNI_TRUE;
+}
+
+// public native int getDetTargetSize();
+JNIEXPORT jint JNICALL Java_com_tencent_yolo11ncnn_YOLO11Ncnn_getDetTargetSize(JNIEnv* env, jobject thiz)
+{
+    return g_sizecontroller.get_size();
+}
+
+// public native String getSizeHistory();
+JNIEXPORT jstring JNICALL Java_com_tencent_yolo11ncnn_YOLO11Ncnn_getSizeHistory(JNIEnv* env, jobject thiz)
+{
+    std::deque<SizeController::Decision> history = g_sizecontroller.get_history();
+
+    // one "time_ms from to latency_ms" line per decision, oldest first
+    std::string text;
+    for (size_t i = 0; i < history.size(); i++)
+    {
+        const SizeController::Decision& d = history[i];
+
+        char line[128];
+        sprintf(line, "%.0f %d %d %.2f\n", d.time, d.from_size, d.to_size, d.latency);
+        text += line;
+    }
+
+    return env->NewStringUTF(text.c_str());
+}
+
 // public native boolean openCamera(int facing);
 JNIEXPORT jboolean JNICALL Java_com_tencent_yolo11ncnn_YOLO11Ncnn_openCamera(JNIEnv* env, jobject thiz, jint facing)
 {
@@ -0,0 +1,293 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2025 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "yolo11nms.h"
+
+#include <algorithm>
+
+#include <math.h>
+#include <string.h>
+
+#if __ARM_NEON
+#include <arm_neon.h>
+#endif // __ARM_NEON
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+
+// below this many proposals a class is scanned as one cell
+static const int min_grid_proposals = 32;
+
+// cells are this many mean box sides wide, a box then spans at most 2 cells per axis on average
+static const float cell_box_ratio = 2.f;
+
+static const int max_grid_cells = 16; // per axis
+
+// highest score first, ties by proposal index, scores are never negative so their bits sort as integers
+static inline uint64_t score_key(float prob, int index)
+{
+    uint32_t bits;
+    memcpy(&bits, &prob, sizeof(bits));
+    return ((uint64_t)(0xffffffffu - bits) << 32) | (uint32_t)index;
+}
+
+static inline int key_index(uint64_t key)
+{
+    return (int)(key & 0xffffffffu);
+}
+
+// some kept box of the cell overlaps d by more than nms_threshold
+// iou > t is tested as inter > t * union, which needs no division and agrees for any non-empty union
+static bool overlaps_any(const NmsCell& cell, const Detection& d, float area, float nms_threshold)
+{
+    const int n = (int)cell.x0.size();
+    const float* px0 = cell.x0.data();
+    const float* py0 = cell.y0.data();
+    const float* px1 = cell.x1.data();
+    const float* py1 = cell.y1.data();
+    const float* parea = cell.area.data();
+
+    int i = 0;
+#if __ARM_NEON
+    {
+        float32x4_t _x0 = vdupq_n_f32(d.x0);
+        float32x4_t _y0 = vdupq_n_f32(d.y0);
+        float32x4_t _x1 = vdupq_n_f32(d.x1);
+        float32x4_t _y1 = vdupq_n_f32(d.y1);
+        float32x4_t _area = vdupq_n_f32(area);
+        float32x4_t _thr = vdupq_n_f32(nms_threshold);
+        float32x4_t _zero = vdupq_n_f32(0.f);
+        for (; i + 3 < n; i += 4)
+        {
+            float32x4_t _w = vsubq_f32(vminq_f32(_x1, vld1q_f32(px1 + i)), vmaxq_f32(_x0, vld1q_f32(px0 + i)));
+            float32x4_t _h = vsubq_f32(vminq_f32(_y1, vld1q_f32(py1 + i)), vmaxq_f32(_y0, vld1q_f32(py0 + i)));
+            float32x4_t _inter = vmulq_f32(vmaxq_f32(_w, _zero), vmaxq_f32(_h, _zero));
+            float32x4_t _union = vsubq_f32(vaddq_f32(_area, vld1q_f32(parea + i)), _inter);
+            uint32x4_t _over = vcgtq_f32(_inter, vmulq_f32(_thr, _union));
+#if __aarch64__
+            if (vmaxvq_u32(_over))
+                return true;
+#else
+            uint32x2_t _over2 = vorr_u32(vget_low_u32(_over), vget_high_u32(_over));
+            if (vget_lane_u32(vpmax_u32(_over2, _over2), 0))
+                return true;
+#endif
+        }
+    }
+#elif __SSE2__
+    {
+        __m128 _x0 = _mm_set1_ps(d.x0);
+        __m128 _y0 = _mm_set1_ps(d.y0);
+        __m128 _x1 = _mm_set1_ps(d.x1);
+        __m128 _y1 = _mm_set1_ps(d.y1);
+        __m128 _area = _mm_set1_ps(area);
+        __m128 _thr = _mm_set1_ps(nms_threshold);
+        __m128 _zero = _mm_setzero_ps();
+        for (; i + 3 < n; i += 4)
+        {
+            __m128 _w = _mm_sub_ps(_mm_min_ps(_x1, _mm_loadu_ps(px1 + i)), _mm_max_ps(_x0, _mm_loadu_ps(px0 + i)));
+            __m128 _h = _mm_sub_ps(_mm_min_ps(_y1, _mm_loadu_ps(py1 + i)), _mm_max_ps(_y0, _mm_loadu_ps(py0 + i)));
+            __m128 _inter = _mm_mul_ps(_mm_max_ps(_w, _zero), _mm_max_ps(_h, _zero));
+            __m128 _union = _mm_sub_ps(_mm_add_ps(_area, _mm_loadu_ps(parea + i)), _inter);
+            if (_mm_movemask_ps(_mm_cmpgt_ps(_inter, _mm_mul_ps(_thr, _union))))
+                return true;
+        }
+    }
+#endif // __ARM_NEON
+    for (; i < n; i++)
+    {
+        float w = std::min(d.x1, px1[i]) - std::max(d.x0, px0[i]);
+        float h = std::min(d.y1, py1[i]) - std::max(d.y0, py0[i]);
+        float inter = std::max(w, 0.f) * std::max(h, 0.f);
+        float union_area = area + parea[i] - inter;
+        if (inter > nms_threshold * union_area)
+            return true;
+    }
+
+    return false;
+}
+
+static void add_box(NmsCell& cell, const Detection& d, float area)
+{
+    cell.x0.push_back(d.x0);
+    cell.y0.push_back(d.y0);
+    cell.x1.push_back(d.x1);
+    cell.y1.push_back(d.y1);
+    cell.area.push_back(area);
+}
+
+// greedy nms of one class, ranks index the sorted keys and come highest score first
+static void nms_class(const std::vector<Detection>& proposals, const uint64_t* keys, const int* ranks, int count, float nms_threshold, NmsWorkspace& ws)
+{
+    if (count == 1)
+    {
+        ws.kept.push_back(ranks[0]);
+        return;
+    }
+
+    // grid over the extent of the class, boxes that overlap share a cell since their overlap lies in one
+    float bx0 = proposals[key_index(keys[ranks[0]])].x0;
+    float by0 = proposals[key_index(keys[ranks[0]])].y0;
+    float bx1 = bx0;
+    float by1 = by0;
+    float side_sum = 0.f;
+    for (int i = 0; i < count; i++)
+    {
+        const Detection& d = proposals[key_index(keys[ranks[i]])];
+        bx0 = std::min(bx0, d.x0);
+        by0 = std::min(by0, d.y0);
+        bx1 = std::max(bx1, d.x1);
+        by1 = std::max(by1, d.y1);
+        side_sum += std::max(d.x1 - d.x0, d.y1 - d.y0);
+    }
+
+    int grid_x = 1;
+    int grid_y = 1;
+    if (count >= min_grid_proposals)
+    {
+        const float cell_side = std::max(side_sum / count * cell_box_ratio, 1.f);
+        grid_x = std::min(std::max((int)((bx1 - bx0) / cell_side), 1), max_grid_cells);
+        grid_y = std::min(std::max((int)((by1 - by0) / cell_side), 1), max_grid_cells);
+    }
+
+    const float cell_w = std::max((bx1 - bx0) / grid_x, 1e-6f);
+    const float cell_h = std::max((by1 - by0) / grid_y, 1e-6f);
+
+    // cells keep their capacity across classes and frames
+    if ((int)ws.cells.size() < grid_x * grid_y)
+        ws.cells.resize(grid_x * grid_y);
+
+    for (int i = 0; i < grid_x * grid_y; i++)
+    {
+        NmsCell& cell = ws.cells[i];
+        cell.x0.clear();
+        cell.y0.clear();
+        cell.x1.clear();
+        cell.y1.clear();
+        cell.area.clear();
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        const Detection& d = proposals[key_index(keys[ranks[i]])];
+
+        const float area = (d.x1 - d.x0) * (d.y1 - d.y0);
+
+        const int cx0 = std::min(std::max((int)((d.x0 - bx0) / cell_w), 0), grid_x - 1);
+        const int cy0 = std::min(std::max((int)((d.y0 - by0) / cell_h), 0), grid_y - 1);
+        const int cx1 = std::min(std::max((int)((d.x1 - bx0) / cell_w), 0), grid_x - 1);
+        const int cy1 = std::min(std::max((int)((d.y1 - by0) / cell_h), 0), grid_y - 1);
+
+        bool keep = true;
+        for (int y = cy0; y <= cy1 && keep; y++)
+        {
+            for (int x = cx0; x <= cx1 && keep; x++)
+            {
+                if (overlaps_any(ws.cells[y * grid_x + x], d, area, nms_threshold))
+                    keep = false;
+            }
+        }
+
+        if (!keep)
+            continue;
+
+        ws.kept.push_back(ranks[i]);
+
+        for (int y = cy0; y <= cy1; y++)
+        {
+            for (int x = cx0; x <= cx1; x++)
+            {
+                add_box(ws.cells[y * grid_x + x], d, area);
+            }
+        }
+    }
+}
+
+void nms_detections(const std::vector<Detection>& proposals, std::vector<int>& picked, float nms_threshold, int top_k, int max_det, bool agnostic, NmsWorkspace& ws)
+{
+    picked.clear();
+
+    const int n = (int)proposals.size();
+    if (n == 0)
+        return;
+
+    // sorting moves 8 byte keys, top_k only orders what it keeps
+    ws.keys.resize(n);
+    for (int i = 0; i < n; i++)
+    {
+        ws.keys[i] = score_key(proposals[i].prob, i);
+    }
+
+    if (top_k > 0 && n > top_k)
+    {
+        std::nth_element(ws.keys.begin(), ws.keys.begin() + top_k, ws.keys.end());
+        ws.keys.resize(top_k);
+    }
+    std::sort(ws.keys.begin(), ws.keys.end());
+
+    const int count = (int)ws.keys.size();
+
+    // ranks bucketed by class, each bucket still highest score first
+    int num_class = 1;
+    if (!agnostic)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            num_class = std::max(num_class, proposals[key_index(ws.keys[i])].label + 1);
+        }
+    }
+
+    ws.class_start.assign(num_class + 1, 0);
+    for (int i = 0; i < count; i++)
+    {
+        const int label = agnostic ? 0 : proposals[key_index(ws.keys[i])].label;
+        ws.class_start[label + 1]++;
+    }
+    for (int c = 0; c < num_class; c++)
+    {
+        ws.class_start[c + 1] += ws.class_start[c];
+    }
+
+    ws.class_ranks.resize(count);
+    ws.class_next.assign(ws.class_start.begin(), ws.class_start.end() - 1);
+    for (int i = 0; i < count; i++)
+    {
+        const int label = agnostic ? 0 : proposals[key_index(ws.keys[i])].label;
+        ws.class_ranks[ws.class_next[label]++] = i;
+    }
+
+    ws.kept.clear();
+    for (int c = 0; c < num_class; c++)
+    {
+        const int start = ws.class_start[c];
+        const int end = ws.class_start[c + 1];
+        if (start == end)
+            continue;
+
+        nms_class(proposals, ws.keys.data(), ws.class_ranks.data() + start, end - start, nms_threshold, ws);
+    }
+
+    // back to one list highest score first, then capped
+    std::sort(ws.kept.begin(), ws.kept.end());
+
+    int kept_count = (int)ws.kept.size();
+    if (max_det > 0)
+        kept_count = std::min(kept_count, max_det);
+
+    picked.resize(kept_count);
+    for (int i = 0; i < kept_count; i++)
+    {
+        picked[i] = key_index(ws.keys[ws.kept[i]]);
+    }
+}
@@ -0,0 +1,65 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2025 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef YOLO11NMS_H
+#define YOLO11NMS_H
+
+#include <stdint.h>
+
+#include <vector>
+
+// one proposal of the decode, plain data so collecting, sorting and nms move 32 bytes at a time
+// masks, keypoints and rotated rects are only made for the proposals that nms keeps
+struct Detection
+{
+    float x0; // box in letterbox pixels
+    float y0;
+    float x1;
+    float y1;
+    float angle; // degrees, obb turns the box by this about its center, 0 otherwise
+    float prob;
+    int label;
+    int gindex; // head row of the anchor
+};
+
+// boxes kept so far in one cell of the grid, one array per coordinate
+struct NmsCell
+{
+    std::vector<float> x0;
+    std::vector<float> y0;
+    std::vector<float> x1;
+    std::vector<float> y1;
+    std::vector<float> area;
+};
+
+// scratch of nms_detections, kept in the context so frames after the first do not allocate
+struct NmsWorkspace
+{
+    std::vector<uint64_t> keys; // score bits and proposal index
+    std::vector<int> class_start;
+    std::vector<int> class_ranks;
+    std::vector<int> class_next;
+    std::vector<int> kept;
+    std::vector<NmsCell> cells;
+};
+
+// greedy nms over axis-aligned boxes, keeps the same proposals as comparing each one, from the highest
+// score down, against every box kept before it
+// only the top_k highest scoring proposals take part and at most max_det are kept, 0 lifts either cap
+// classes are suppressed apart unless agnostic, and within a class the kept boxes go into a uniform grid
+// so a proposal is only tested against kept boxes sharing a cell with it, 4 at a time
+// picked holds proposal indices from the highest score down
+void nms_detections(const std::vector<Detection>& proposals, std::vector<int>& picked, float nms_threshold, int top_k, int max_det, bool agnostic, NmsWorkspace& ws);
+
+#endif // YOLO11NMS_H
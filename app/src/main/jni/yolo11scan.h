@@ -0,0 +1,146 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2025 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef YOLO11SCAN_H
+#define YOLO11SCAN_H
+
+#include <algorithm>
+#include <vector>
+
+#include <float.h>
+#include <math.h>
+
+#if __ARM_NEON
+#include <arm_neon.h>
+#endif // __ARM_NEON
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+
+// per-anchor class scan of the proposal loops
+// scores stay logits, the threshold moves into logit space once per frame and sigmoid runs only for survivors
+
+// sigmoid(x) >= p is x >= log(p / (1 - p))
+static inline float prob_to_logit(float prob_threshold)
+{
+    if (prob_threshold <= 0.f)
+        return -FLT_MAX;
+    if (prob_threshold >= 1.f)
+        return FLT_MAX;
+
+    return logf(prob_threshold / (1.f - prob_threshold));
+}
+
+// largest of n scores, the lanes keep a running max and fold once at the end
+static inline float max_score(const float* p, int n)
+{
+    int i = 0;
+    float max = -FLT_MAX;
+#if __ARM_NEON
+    if (n >= 4)
+    {
+        float32x4_t _max = vld1q_f32(p);
+        for (i = 4; i + 3 < n; i += 4)
+        {
+            _max = vmaxq_f32(_max, vld1q_f32(p + i));
+        }
+
+#if __aarch64__
+        max = vmaxvq_f32(_max);
+#else
+        float32x2_t _max2 = vpmax_f32(vget_low_f32(_max), vget_high_f32(_max));
+        _max2 = vpmax_f32(_max2, _max2);
+        max = vget_lane_f32(_max2, 0);
+#endif
+    }
+#elif __SSE2__
+    if (n >= 4)
+    {
+        __m128 _max = _mm_loadu_ps(p);
+        for (i = 4; i + 3 < n; i += 4)
+        {
+            _max = _mm_max_ps(_max, _mm_loadu_ps(p + i));
+        }
+
+        _max = _mm_max_ps(_max, _mm_shuffle_ps(_max, _max, _MM_SHUFFLE(1, 0, 3, 2)));
+        _max = _mm_max_ps(_max, _mm_shuffle_ps(_max, _max, _MM_SHUFFLE(2, 3, 0, 1)));
+        max = _mm_cvtss_f32(_max);
+    }
+#endif // __ARM_NEON
+    for (; i < n; i++)
+    {
+        max = std::max(max, p[i]);
+    }
+
+    return max;
+}
+
+// first index holding max, only asked for anchors that passed the threshold
+static inline int find_score(const float* p, int n, float max)
+{
+    for (int i = 0; i < n; i++)
+    {
+        if (p[i] == max)
+            return i;
+    }
+
+    return 0;
+}
+
+// rows y0..y1 of the grid of one stride level, the unit of the parallel proposal decode
+struct ProposalBand
+{
+    int stride;
+    int row_offset; // head row of the first anchor of the level
+    int y0;
+    int y1;
+};
+
+// cut every level into bands of about the same anchor count, a few per thread so a band full of
+// candidates does not hold up the rest, bands come out in head row order
+static inline void plan_proposal_bands(int w, int h, const std::vector<int>& strides, int num_threads, std::vector<ProposalBand>& bands)
+{
+    bands.clear();
+
+    int anchors = 0;
+    for (size_t i = 0; i < strides.size(); i++)
+    {
+        anchors += (w / strides[i]) * (h / strides[i]);
+    }
+
+    const int band_anchors = num_threads > 1 ? std::max(anchors / (num_threads * 4), 1) : anchors;
+
+    int row_offset = 0;
+    for (size_t i = 0; i < strides.size(); i++)
+    {
+        const int stride = strides[i];
+        const int num_grid_x = w / stride;
+        const int num_grid_y = h / stride;
+
+        const int band_rows = std::max(band_anchors / std::max(num_grid_x, 1), 1);
+        for (int y = 0; y < num_grid_y; y += band_rows)
+        {
+            ProposalBand band;
+            band.stride = stride;
+            band.row_offset = row_offset;
+            band.y0 = y;
+            band.y1 = std::min(y + band_rows, num_grid_y);
+            bands.push_back(band);
+        }
+
+        row_offset += num_grid_x * num_grid_y;
+    }
+}
+
+#endif // YOLO11SCAN_H
@@ -0,0 +1,264 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2025 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "yolo11session.h"
+
+#include <algorithm>
+
+#include <benchmark.h>
+#include <cpu.h>
+
+YOLO11Session::YOLO11Session()
+{
+    frame_seq = 0;
+    pending = 0;
+    quit = false;
+}
+
+YOLO11Session::~YOLO11Session()
+{
+    {
+        ncnn::MutexLockGuard g(worker_lock);
+
+        quit = true;
+        frame_condition.broadcast();
+    }
+
+    for (size_t i = 0; i < worker_threads.size(); i++)
+    {
+        worker_threads[i]->join();
+        delete worker_threads[i];
+    }
+}
+
+void YOLO11Session::run_job(Job& job)
+{
+    YOLO11Context* ctx = job.yolo11->acquire_context();
+    ctx->num_threads = job.num_threads;
+
+    double t0 = ncnn::get_current_time();
+    job.yolo11->detect(*job.lb, *job.objects, *ctx);
+    double t1 = ncnn::get_current_time();
+
+    job.yolo11->release_context(ctx);
+
+    job.latency = (float)(t1 - t0);
+}
+
+void* YOLO11Session::worker_entry(void* args)
+{
+    WorkerArgs* worker = (WorkerArgs*)args;
+    YOLO11Session* session = worker->session;
+
+    for (;;)
+    {
+        {
+            ncnn::MutexLockGuard g(session->worker_lock);
+
+            while (!session->quit && session->frame_seq == worker->seen_seq)
+            {
+                session->frame_condition.wait(session->worker_lock);
+            }
+
+            if (session->quit)
+                break;
+
+            worker->seen_seq = session->frame_seq;
+        }
+
+        run_job(session->jobs[worker->index]);
+
+        {
+            ncnn::MutexLockGuard g(session->worker_lock);
+
+            if (--session->pending == 0)
+                session->done_condition.signal();
+        }
+    }
+
+    return 0;
+}
+
+void YOLO11Session::start_workers(int count)
+{
+    if ((int)worker_threads.size() >= count)
+        return;
+
+    // first frame, or a model added since, the threads hold pointers into worker_args so start over
+    {
+        ncnn::MutexLockGuard g(worker_lock);
+
+        quit = true;
+        frame_condition.broadcast();
+    }
+
+    for (size_t i = 0; i < worker_threads.size(); i++)
+    {
+        worker_threads[i]->join();
+        delete worker_threads[i];
+    }
+    worker_threads.clear();
+
+    quit = false;
+
+    worker_args.resize(count);
+    for (int i = 0; i < count; i++)
+    {
+        worker_args[i].session = this;
+        worker_args[i].index = i + 1;
+        worker_args[i].seen_seq = frame_seq;
+
+        worker_threads.push_back(new ncnn::Thread(worker_entry, &worker_args[i]));
+    }
+}
+
+void YOLO11Session::add(const std::shared_ptr<YOLO11>& yolo11)
+{
+    models.push_back(yolo11);
+}
+
+int YOLO11Session::size() const
+{
+    return (int)models.size();
+}
+
+const std::shared_ptr<YOLO11>& YOLO11Session::get(int i) const
+{
+    return models[i];
+}
+
+bool YOLO11Session::is_ready() const
+{
+    for (size_t i = 0; i < models.size(); i++)
+    {
+        if (!models[i]->is_ready())
+            return false;
+    }
+
+    return true;
+}
+
+int YOLO11Session::detect(const cv::Mat& rgb, SessionResult& result)
+{
+    const int model_count = (int)models.size();
+
+    result.objects.clear();
+    result.objects.resize(model_count);
+    result.latency.assign(model_count, 0.f);
+    result.letterbox_latency = 0.f;
+
+    if (model_count == 0)
+        return 0;
+
+    // one letterbox per distinct input, det and pose at the same size share it
+    std::vector<int> target_sizes;
+    std::vector<bool> squares;
+    std::vector<bool> normalizes;
+    std::vector<int> letterbox_index(model_count);
+    for (int i = 0; i < model_count; i++)
+    {
+        int target_size = 0;
+        bool square = false;
+        models[i]->get_letterbox_size(target_size, square);
+
+        // a model that folded the normalization needs its own unnormalized copy
+        const bool normalize = !models[i]->is_normalize_folded();
+
+        int index = -1;
+        for (size_t j = 0; j < target_sizes.size(); j++)
+        {
+            if (target_sizes[j] == target_size && squares[j] == square && normalizes[j] == normalize)
+            {
+                index = (int)j;
+                break;
+            }
+        }
+
+        if (index == -1)
+        {
+            index = (int)target_sizes.size();
+            target_sizes.push_back(target_size);
+            squares.push_back(square);
+            normalizes.push_back(normalize);
+        }
+
+        letterbox_index[i] = index;
+    }
+
+    // must outlive every worker, the extractors only hold references to in_pad
+    std::vector<Letterbox> letterboxes(target_sizes.size());
+
+    double t0 = ncnn::get_current_time();
+    for (size_t j = 0; j < target_sizes.size(); j++)
+    {
+        YOLO11::letterbox(rgb, target_sizes[j], squares[j], normalizes[j], letterboxes[j], letterbox_context);
+    }
+    double t1 = ncnn::get_current_time();
+
+    result.letterbox_latency = (float)(t1 - t0);
+
+    // the models do not depend on each other, split the big cores between them
+    const int num_threads = std::max(ncnn::get_big_cpu_count() / model_count, 1);
+
+    jobs.resize(model_count);
+    for (int i = 0; i < model_count; i++)
+    {
+        jobs[i].yolo11 = models[i].get();
+        jobs[i].lb = &letterboxes[letterbox_index[i]];
+        jobs[i].objects = &result.objects[i];
+        jobs[i].num_threads = model_count == 1 ? 0 : num_threads;
+        jobs[i].latency = 0.f;
+    }
+
+    start_workers(model_count - 1);
+
+    if (model_count > 1)
+    {
+        ncnn::MutexLockGuard g(worker_lock);
+
+        pending = model_count - 1;
+        frame_seq++;
+        frame_condition.broadcast();
+    }
+
+    // the calling thread runs the first model itself
+    run_job(jobs[0]);
+
+    if (model_count > 1)
+    {
+        ncnn::MutexLockGuard g(worker_lock);
+
+        while (pending > 0)
+        {
+            done_condition.wait(worker_lock);
+        }
+    }
+
+    for (int i = 0; i < model_count; i++)
+    {
+        result.latency[i] = jobs[i].latency;
+    }
+
+    return 0;
+}
+
+int YOLO11Session::draw(cv::Mat& rgb, const SessionResult& result)
+{
+    for (size_t i = 0; i < models.size() && i < result.objects.size(); i++)
+    {
+        models[i]->draw(rgb, result.objects[i]);
+    }
+
+    return 0;
+}
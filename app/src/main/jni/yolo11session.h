@@ -0,0 +1,94 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2025 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef YOLO11SESSION_H
+#define YOLO11SESSION_H
+
+#include <memory>
+#include <vector>
+
+#include <platform.h>
+
+#include "yolo11.h"
+
+struct SessionResult
+{
+    // one list per model, in the order the models were added
+    std::vector<std::vector<Object> > objects;
+
+    // milliseconds spent letterboxing, and in each model's detect
+    float letterbox_latency;
+    std::vector<float> latency;
+};
+
+// runs several models on the same frame, det and pose or det and cls
+// each distinct letterbox is made once and shared by every model that takes it
+// the models run in parallel and split the cpu cores between them, the calling thread runs the first
+// and every other one has a worker thread kept for the life of the session
+class YOLO11Session
+{
+public:
+    YOLO11Session();
+    ~YOLO11Session();
+
+    void add(const std::shared_ptr<YOLO11>& yolo11);
+    int size() const;
+    const std::shared_ptr<YOLO11>& get(int i) const;
+
+    bool is_ready() const;
+
+    // one frame at a time, not to be called from several threads at once
+    int detect(const cv::Mat& rgb, SessionResult& result);
+    int draw(cv::Mat& rgb, const SessionResult& result);
+
+private:
+    struct Job
+    {
+        YOLO11* yolo11;
+        const Letterbox* lb;
+        std::vector<Object>* objects;
+        int num_threads;
+        float latency;
+    };
+
+    struct WorkerArgs
+    {
+        YOLO11Session* session;
+        int index;             // job run by this worker
+        unsigned int seen_seq; // last frame it picked up
+    };
+
+    static void run_job(Job& job);
+    static void* worker_entry(void* args);
+    void start_workers(int count);
+
+    std::vector<std::shared_ptr<YOLO11> > models;
+
+    // letterbox Mats only, used by the thread calling detect
+    YOLO11Context letterbox_context;
+
+    // jobs[0] runs on the calling thread, jobs[i] on worker_threads[i - 1]
+    std::vector<Job> jobs;
+    std::vector<WorkerArgs> worker_args;
+    std::vector<ncnn::Thread*> worker_threads;
+
+    ncnn::Mutex worker_lock;
+    ncnn::ConditionVariable frame_condition; // a new frame or quit
+    ncnn::ConditionVariable done_condition;  // the last worker of a frame finished
+    unsigned int frame_seq;
+    int pending;
+    bool quit;
+};
+
+#endif // YOLO11SESSION_H
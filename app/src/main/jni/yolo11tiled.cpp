@@ -0,0 +1,259 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2025 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "yolo11tiled.h"
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <algorithm>
+
+#include <cpu.h>
+
+// obb models fill rrect only, det and seg fill rect only
+static inline bool is_rotated(const Object& obj)
+{
+    return obj.rrect.size.area() > 0.f;
+}
+
+static inline float intersection_area(const Object& a, const Object& b)
+{
+    if (is_rotated(a) && is_rotated(b))
+    {
+        std::vector<cv::Point2f> intersection;
+        cv::rotatedRectangleIntersection(a.rrect, b.rrect, intersection);
+        if (intersection.empty())
+            return 0.f;
+
+        return cv::contourArea(intersection);
+    }
+
+    cv::Rect_<float> inter = a.rect & b.rect;
+    return inter.area();
+}
+
+static inline float object_area(const Object& obj)
+{
+    return is_rotated(obj) ? obj.rrect.size.area() : obj.rect.area();
+}
+
+// rotated boxes of obb, axis-aligned ones go through nms_detections
+static void nms_sorted_bboxes(const std::vector<Object>& objects, std::vector<int>& picked, float nms_threshold)
+{
+    picked.clear();
+
+    const int n = objects.size();
+
+    std::vector<float> areas(n);
+    for (int i = 0; i < n; i++)
+    {
+        areas[i] = object_area(objects[i]);
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        const Object& a = objects[i];
+
+        int keep = 1;
+        for (int j = 0; j < (int)picked.size(); j++)
+        {
+            const Object& b = objects[picked[j]];
+
+            if (a.label != b.label)
+                continue;
+
+            // intersection over union
+            float inter_area = intersection_area(a, b);
+            float union_area = areas[i] + areas[picked[j]] - inter_area;
+            if (inter_area / union_area > nms_threshold)
+            {
+                keep = 0;
+                break;
+            }
+        }
+
+        if (keep)
+            picked.push_back(i);
+    }
+}
+
+// tile origins along one axis, the last tile is shifted inward to end at the frame edge
+static void tile_offsets(int size, int tile, int stride, std::vector<int>& offsets)
+{
+    offsets.clear();
+
+    if (size <= tile)
+    {
+        offsets.push_back(0);
+        return;
+    }
+
+    for (int o = 0; o + tile < size; o += stride)
+    {
+        offsets.push_back(o);
+    }
+    offsets.push_back(size - tile);
+}
+
+static void offset_object(Object& obj, int ox, int oy)
+{
+    obj.rect.x += ox;
+    obj.rect.y += oy;
+    obj.rrect.center.x += ox;
+    obj.rrect.center.y += oy;
+
+    for (size_t k = 0; k < obj.keypoints.size(); k++)
+    {
+        obj.keypoints[k].p.x += ox;
+        obj.keypoints[k].p.y += oy;
+    }
+}
+
+YOLO11Tiled::YOLO11Tiled()
+{
+    overlap = 0.2f;
+    coarse = true;
+    nms_threshold = 0.45f;
+}
+
+void YOLO11Tiled::set_overlap(float _overlap)
+{
+    overlap = std::min(std::max(_overlap, 0.f), 0.9f);
+}
+
+void YOLO11Tiled::set_coarse(bool enable)
+{
+    coarse = enable;
+}
+
+void YOLO11Tiled::set_nms_threshold(float _nms_threshold)
+{
+    nms_threshold = _nms_threshold;
+}
+
+int YOLO11Tiled::detect(YOLO11& yolo11, const cv::Mat& rgb, std::vector<Object>& objects)
+{
+    const int tile = yolo11.get_det_target_size();
+    const int stride = std::max((int)(tile * (1.f - overlap)), 32);
+
+    std::vector<int> xs;
+    std::vector<int> ys;
+    tile_offsets(rgb.cols, tile, stride, xs);
+    tile_offsets(rgb.rows, tile, stride, ys);
+
+    std::vector<cv::Rect> rois;
+    for (size_t i = 0; i < ys.size(); i++)
+    {
+        for (size_t j = 0; j < xs.size(); j++)
+        {
+            rois.push_back(cv::Rect(xs[j], ys[i], std::min(tile, rgb.cols), std::min(tile, rgb.rows)));
+        }
+    }
+
+    // a frame that fits in one tile needs no coarse pass
+    const bool run_coarse = coarse && rois.size() > 1;
+    if (run_coarse)
+        rois.push_back(cv::Rect(0, 0, rgb.cols, rgb.rows));
+
+    const int job_count = (int)rois.size();
+    const int num_threads = std::min(ncnn::get_big_cpu_count(), job_count);
+
+    std::vector<YOLO11Context*> contexts(num_threads);
+    for (int i = 0; i < num_threads; i++)
+    {
+        contexts[i] = yolo11.acquire_context();
+        contexts[i]->num_threads = 1;
+    }
+
+    std::vector<std::vector<Object> > job_objects(job_count);
+
+    // a tile roi letterboxes at scale 1, the coarse pass downscales the whole frame as usual
+    #pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+    for (int i = 0; i < job_count; i++)
+    {
+        YOLO11Context& ctx = *contexts[ncnn::get_omp_thread_num()];
+
+        const cv::Rect& roi = rois[i];
+
+        yolo11.detect(rgb(roi), job_objects[i], ctx);
+
+        for (size_t k = 0; k < job_objects[i].size(); k++)
+        {
+            offset_object(job_objects[i][k], roi.x, roi.y);
+        }
+    }
+
+    for (int i = 0; i < num_threads; i++)
+    {
+        yolo11.release_context(contexts[i]);
+    }
+
+    std::vector<Object> proposals;
+    for (int i = 0; i < job_count; i++)
+    {
+        proposals.insert(proposals.end(), job_objects[i].begin(), job_objects[i].end());
+    }
+
+    // boxes cut by a seam score lower than the whole box seen by the neighbour tile or the coarse pass
+    struct
+    {
+        bool operator()(const Object& a, const Object& b) const
+        {
+            return a.prob > b.prob;
+        }
+    } objects_prob_greater;
+    std::stable_sort(proposals.begin(), proposals.end(), objects_prob_greater);
+
+    bool rotated = false;
+    for (size_t i = 0; i < proposals.size(); i++)
+    {
+        rotated = rotated || is_rotated(proposals[i]);
+    }
+
+    std::vector<int> picked;
+    if (rotated)
+    {
+        nms_sorted_bboxes(proposals, picked, nms_threshold);
+    }
+    else
+    {
+        // ties keep the sorted order, so the grid nms picks what the pairwise one did
+        std::vector<Detection> dets(proposals.size());
+        for (size_t i = 0; i < proposals.size(); i++)
+        {
+            const Object& obj = proposals[i];
+
+            Detection& d = dets[i];
+            d.x0 = obj.rect.x;
+            d.y0 = obj.rect.y;
+            d.x1 = obj.rect.x + obj.rect.width;
+            d.y1 = obj.rect.y + obj.rect.height;
+            d.angle = 0.f;
+            d.prob = obj.prob;
+            d.label = obj.label;
+            d.gindex = (int)i;
+        }
+
+        NmsWorkspace ws;
+        nms_detections(dets, picked, nms_threshold, 0, 0, false, ws);
+    }
+
+    objects.resize(picked.size());
+    for (size_t i = 0; i < picked.size(); i++)
+    {
+        objects[i] = proposals[picked[i]];
+    }
+
+    return 0;
+}
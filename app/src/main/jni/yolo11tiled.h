@@ -0,0 +1,44 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2025 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef YOLO11TILED_H
+#define YOLO11TILED_H
+
+#include <vector>
+
+#include "yolo11.h"
+
+// detect small objects on frames much larger than det_target_size, for det, seg and obb models
+// the frame is cut into overlapping tiles of the model input size, each detected at native scale
+// a coarse full-frame pass catches objects larger than a tile, a global nms merges across seams
+class YOLO11Tiled
+{
+public:
+    YOLO11Tiled();
+
+    // fraction of a tile shared with its neighbour
+    void set_overlap(float overlap);
+    void set_coarse(bool enable);
+    void set_nms_threshold(float nms_threshold);
+
+    // tiles and the coarse pass run in parallel, one single-threaded context each
+    int detect(YOLO11& yolo11, const cv::Mat& rgb, std::vector<Object>& objects);
+
+private:
+    float overlap;
+    bool coarse;
+    float nms_threshold;
+};
+
+#endif // YOLO11TILED_H
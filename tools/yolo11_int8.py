@@ -0,0 +1,424 @@
+# Tencent is pleased to support the open source community by making ncnn available.
+#
+# Copyright (C) 2025 THL A29 Limited, a Tencent company. All rights reserved.
+#
+# Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+# in compliance with the License. You may obtain a copy of the License at
+#
+# https://opensource.org/licenses/BSD-3-Clause
+#
+# Unless required by applicable law or agreed to in writing, software distributed
+# under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+# CONDITIONS OF ANY KIND, either express or implied. See the License for the
+# specific language governing permissions and limitations under the License.
+
+# int8 calibration and fp32/int8 comparison for yolo11 ncnn models
+#
+# 1. letterbox replay frames exactly like YOLO11_*::detect and build the calibration table
+#      python3 yolo11_int8.py calibrate yolo11n.ncnn.param yolo11n.ncnn.bin frames/ --target-size 640
+#    this writes yolo11n.table and yolo11n_int8.ncnn.param / yolo11n_int8.ncnn.bin
+# 2. compare int8 against fp32 on the same frames
+#      python3 yolo11_int8.py report yolo11n.ncnn.param yolo11n.ncnn.bin yolo11n_int8.ncnn.param yolo11n_int8.ncnn.bin frames/ --target-size 640
+#
+# requires pip3 install -U ncnn numpy opencv-python, plus ncnn2table and ncnn2int8 from the ncnn tools in PATH
+
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+import cv2
+import numpy as np
+import ncnn
+
+MAX_STRIDE = 32
+STRIDES = (8, 16, 32)
+REG_MAX = 16
+
+
+def list_frames(frames_dir):
+    exts = ('.jpg', '.jpeg', '.png', '.bmp')
+    names = sorted(n for n in os.listdir(frames_dir) if n.lower().endswith(exts))
+    return [os.path.join(frames_dir, n) for n in names]
+
+
+def letterbox(rgb, target_size, square=False):
+    # mirrors the letterbox in YOLO11_*::detect, returns padded uint8 rgb and the inverse transform
+    img_h, img_w = rgb.shape[:2]
+    if img_w > img_h:
+        scale = target_size / img_w
+        w = target_size
+        h = int(img_h * scale)
+    else:
+        scale = target_size / img_h
+        h = target_size
+        w = int(img_w * scale)
+
+    resized = cv2.resize(rgb, (w, h), interpolation=cv2.INTER_LINEAR)
+
+    if square:
+        wpad = target_size - w
+        hpad = target_size - h
+    else:
+        wpad = (w + MAX_STRIDE - 1) // MAX_STRIDE * MAX_STRIDE - w
+        hpad = (h + MAX_STRIDE - 1) // MAX_STRIDE * MAX_STRIDE - h
+
+    in_pad = cv2.copyMakeBorder(resized, hpad // 2, hpad - hpad // 2, wpad // 2, wpad - wpad // 2,
+                                cv2.BORDER_CONSTANT, value=(114, 114, 114))
+    return in_pad, scale, wpad, hpad
+
+
+def calibrate(args):
+    frames = list_frames(args.frames)
+    if not frames:
+        sys.exit('no frames found in %s' % args.frames)
+
+    base = args.output or os.path.splitext(os.path.splitext(args.param)[0])[0]
+    table = base + '.table'
+    int8_param = base + '_int8.ncnn.param'
+    int8_bin = base + '_int8.ncnn.bin'
+
+    # ncnn2table resizes every image to shape=[w,h,3], so we feed it frames that are already
+    # letterboxed to one shape and the resize becomes an identity
+    workdir = tempfile.mkdtemp(prefix='yolo11_calib_')
+    shape = None
+    imagelist = os.path.join(workdir, 'imagelist.txt')
+    with open(imagelist, 'w') as f:
+        for i, path in enumerate(frames):
+            bgr = cv2.imread(path)
+            if bgr is None:
+                continue
+            in_pad, _, _, _ = letterbox(cv2.cvtColor(bgr, cv2.COLOR_BGR2RGB), args.target_size, args.task == 'cls')
+            if shape is None:
+                shape = in_pad.shape
+            if in_pad.shape != shape:
+                print('skip %s, letterbox shape %s differs from %s' % (path, in_pad.shape, shape))
+                continue
+            out = os.path.join(workdir, '%06d.png' % i)
+            cv2.imwrite(out, cv2.cvtColor(in_pad, cv2.COLOR_RGB2BGR))
+            f.write(out + '\n')
+
+    norm = 1 / 255.0
+    subprocess.check_call([
+        'ncnn2table', args.param, args.bin, imagelist, table,
+        'mean=[0,0,0]',
+        'norm=[%f,%f,%f]' % (norm, norm, norm),
+        'shape=[%d,%d,3]' % (shape[1], shape[0]),
+        'pixel=RGB',
+        'thread=%d' % args.threads,
+        'method=%s' % args.method,
+    ])
+    subprocess.check_call(['ncnn2int8', args.param, args.bin, int8_param, int8_bin, table])
+
+    print('calibration table %s' % table)
+    print('int8 model %s %s' % (int8_param, int8_bin))
+
+
+def load_net(param, bin, threads):
+    net = ncnn.Net()
+    net.opt.num_threads = threads
+    net.opt.use_int8_inference = True
+    net.load_param(param)
+    net.load_model(bin)
+    return net
+
+
+# extra outputs after out0, out1 holds mask coefficients for seg, keypoints for pose and the angle for obb,
+# out2 the mask protos of seg
+OUTPUTS = {
+    'det': ('out0',),
+    'seg': ('out0', 'out1', 'out2'),
+    'pose': ('out0', 'out1'),
+    'cls': ('out0',),
+    'obb': ('out0', 'out1'),
+}
+
+# coco keypoint sigmas for oks
+KPT_SIGMAS = np.array([.26, .25, .25, .35, .35, .79, .79, .72, .72, .62, .62, 1.07, 1.07, .87, .87, .89, .89]) / 10.0
+
+
+def run(net, in_pad, task):
+    in_mat = ncnn.Mat(np.ascontiguousarray(in_pad.transpose(2, 0, 1).astype(np.float32) / 255.0))
+
+    ex = net.create_extractor()
+    ex.input('in0', in_mat)
+
+    t0 = time.perf_counter()
+    outs = []
+    for name in OUTPUTS[task]:
+        ret, out = ex.extract(name)
+        outs.append(np.array(out))
+    t1 = time.perf_counter()
+
+    return outs, (t1 - t0) * 1000
+
+
+def sigmoid(x):
+    return 1 / (1 + np.exp(-x))
+
+
+def make_anchors(in_w, in_h):
+    anchors = []
+    for stride in STRIDES:
+        gy, gx = np.mgrid[0:in_h // stride, 0:in_w // stride]
+        cxcy = np.stack([gx.ravel() + 0.5, gy.ravel() + 0.5], axis=1) * stride
+        anchors.append(np.concatenate([cxcy, np.full((cxcy.shape[0], 1), stride)], axis=1))
+    return np.concatenate(anchors, axis=0)
+
+
+def decode(task, outs, in_w, in_h, prob_threshold, nms_threshold):
+    # mirrors generate_proposals and the post-nms steps of YOLO11_<task>::detect in letterbox pixels
+    # returns a dict of boxes, probs, labels and the per-task extra, angles, masks or keypoints
+    pred = outs[0]
+    num_class = pred.shape[1] - REG_MAX * 4
+
+    dets = {
+        'boxes': np.zeros((0, 4)),
+        'probs': np.zeros(0),
+        'labels': np.zeros(0, dtype=int),
+        'angles': np.zeros(0),
+        'masks': np.zeros((0, in_h, in_w), dtype=bool),
+        'keypoints': np.zeros((0, 0, 3)),
+    }
+
+    anchors = make_anchors(in_w, in_h)
+
+    scores = sigmoid(pred[:, REG_MAX * 4:])
+    labels = scores.argmax(axis=1)
+    probs = scores[np.arange(len(labels)), labels]
+    keep = probs >= prob_threshold
+    if num_class == 0 or not keep.any():
+        return dets
+
+    reg = pred[keep, :REG_MAX * 4].reshape(-1, 4, REG_MAX)
+    reg = np.exp(reg - reg.max(axis=2, keepdims=True))
+    reg /= reg.sum(axis=2, keepdims=True)
+    ltrb = (reg * np.arange(REG_MAX)).sum(axis=2) * anchors[keep, 2:3]
+
+    cxcy = anchors[keep, :2]
+    angles = np.zeros(len(ltrb))
+    if task == 'obb':
+        # the box before turning about its center, like rotated_rect in yolo11_obb.cpp
+        angles = (sigmoid(outs[1][keep, 0]) - 0.25) * np.pi
+        xx = (ltrb[:, 2] - ltrb[:, 0]) * 0.5
+        yy = (ltrb[:, 3] - ltrb[:, 1]) * 0.5
+        center = cxcy + np.stack([xx * np.cos(angles) - yy * np.sin(angles), xx * np.sin(angles) + yy * np.cos(angles)], axis=1)
+        size = ltrb[:, :2] + ltrb[:, 2:]
+        boxes = np.concatenate([center - size * 0.5, center + size * 0.5], axis=1)
+        angles = np.degrees(angles)
+    else:
+        boxes = np.concatenate([cxcy - ltrb[:, :2], cxcy + ltrb[:, 2:]], axis=1)
+
+    probs = probs[keep]
+    labels = labels[keep]
+
+    overlap = rotated_iou if task == 'obb' else lambda a, b: iou(a[:4], b[:4])
+    rects = np.concatenate([boxes, angles[:, None]], axis=1)
+
+    order = probs.argsort()[::-1]
+    picked = []
+    for i in order:
+        ok = True
+        for j in picked:
+            if labels[i] == labels[j] and overlap(rects[i], rects[j]) > nms_threshold:
+                ok = False
+                break
+        if ok:
+            picked.append(i)
+
+    picked = np.array(picked, dtype=int)
+    rows = np.flatnonzero(keep)[picked]
+
+    dets['boxes'] = boxes[picked]
+    dets['probs'] = probs[picked]
+    dets['labels'] = labels[picked]
+    dets['angles'] = angles[picked]
+
+    if task == 'seg':
+        protos = outs[2]
+        coeffs = outs[1][rows]
+        masks = sigmoid(coeffs @ protos.reshape(protos.shape[0], -1)).reshape(-1, protos.shape[1], protos.shape[2])
+        binary = np.zeros((len(rows), in_h, in_w), dtype=bool)
+        for i in range(len(rows)):
+            # upsample to the letterbox and keep the part inside the box
+            m = cv2.resize(masks[i], (in_w, in_h), interpolation=cv2.INTER_LINEAR) > 0.5
+            x0, y0, x1, y1 = np.clip(np.round(dets['boxes'][i]), 0, [in_w, in_h, in_w, in_h]).astype(int)
+            binary[i, y0:y1, x0:x1] = m[y0:y1, x0:x1]
+        dets['masks'] = binary
+
+    if task == 'pose':
+        points = outs[1][rows].reshape(len(rows), -1, 3)
+        stride = anchors[rows, 2:3]
+        grid = anchors[rows, :2] / stride - 0.5
+        xy = (grid[:, None, :] + points[:, :, :2] * 2) * stride[:, None, :]
+        dets['keypoints'] = np.concatenate([xy, sigmoid(points[:, :, 2:3])], axis=2)
+
+    return dets
+
+
+def iou(a, b):
+    iw = min(a[2], b[2]) - max(a[0], b[0])
+    ih = min(a[3], b[3]) - max(a[1], b[1])
+    if iw <= 0 or ih <= 0:
+        return 0.0
+    inter = iw * ih
+    union = (a[2] - a[0]) * (a[3] - a[1]) + (b[2] - b[0]) * (b[3] - b[1]) - inter
+    return inter / union
+
+
+def rotated_iou(a, b):
+    # x0 y0 x1 y1 angle, the same intersection as intersection_area in yolo11_obb.cpp
+    ra = (((a[0] + a[2]) * 0.5, (a[1] + a[3]) * 0.5), (a[2] - a[0], a[3] - a[1]), a[4])
+    rb = (((b[0] + b[2]) * 0.5, (b[1] + b[3]) * 0.5), (b[2] - b[0], b[3] - b[1]), b[4])
+    ret, points = cv2.rotatedRectangleIntersection(ra, rb)
+    if ret == cv2.INTERSECT_NONE or points is None:
+        return 0.0
+    inter = cv2.contourArea(points)
+    union = (a[2] - a[0]) * (a[3] - a[1]) + (b[2] - b[0]) * (b[3] - b[1]) - inter
+    return inter / union if union > 0 else 0.0
+
+
+def mask_iou(a, b):
+    union = np.logical_or(a, b).sum()
+    return np.logical_and(a, b).sum() / union if union > 0 else 0.0
+
+
+def oks(ref_box, ref_points, points):
+    # coco object keypoint similarity, scaled by the reference box area and over its visible keypoints
+    area = (ref_box[2] - ref_box[0]) * (ref_box[3] - ref_box[1])
+    visible = ref_points[:, 2] > 0.5
+    if area <= 0 or not visible.any():
+        return 0.0
+    sigmas = KPT_SIGMAS if len(ref_points) == len(KPT_SIGMAS) else np.full(len(ref_points), KPT_SIGMAS.mean())
+    d2 = ((points[:, :2] - ref_points[:, :2]) ** 2).sum(axis=1)
+    e = d2 / (2 * area * (2 * sigmas) ** 2)
+    return np.exp(-e)[visible].mean()
+
+
+def similarity(task, ref, test, j, i):
+    # the quality measure each task is judged by, box iou for det
+    if task == 'obb':
+        return rotated_iou(np.append(test['boxes'][i], test['angles'][i]), np.append(ref['boxes'][j], ref['angles'][j]))
+    if task == 'seg':
+        return mask_iou(test['masks'][i], ref['masks'][j])
+    if task == 'pose':
+        return oks(ref['boxes'][j], ref['keypoints'][j], test['keypoints'][i])
+    return iou(test['boxes'][i], ref['boxes'][j])
+
+
+def match(task, ref, test, iou_threshold):
+    # greedy same-label matching of test detections against the fp32 reference
+    used = set()
+    matched = 0
+    for i in test['probs'].argsort()[::-1]:
+        best = -1
+        best_iou = iou_threshold
+        for j in range(len(ref['boxes'])):
+            if j in used or ref['labels'][j] != test['labels'][i]:
+                continue
+            v = similarity(task, ref, test, j, i)
+            if v >= best_iou:
+                best = j
+                best_iou = v
+        if best >= 0:
+            used.add(best)
+            matched += 1
+
+    return matched
+
+
+def report(args):
+    frames = list_frames(args.frames)
+    if not frames:
+        sys.exit('no frames found in %s' % args.frames)
+
+    fp32 = load_net(args.param, args.bin, args.threads)
+    int8 = load_net(args.int8_param, args.int8_bin, args.threads)
+
+    fp32_times = []
+    int8_times = []
+    n_ref = 0
+    n_test = 0
+    n_matched = 0
+    top1_agree = 0
+    for path in frames:
+        bgr = cv2.imread(path)
+        if bgr is None:
+            continue
+        in_pad, _, _, _ = letterbox(cv2.cvtColor(bgr, cv2.COLOR_BGR2RGB), args.target_size, args.task == 'cls')
+
+        # warm both nets once so the first frame does not skew latency
+        if not fp32_times:
+            run(fp32, in_pad, args.task)
+            run(int8, in_pad, args.task)
+
+        out_fp32, t_fp32 = run(fp32, in_pad, args.task)
+        out_int8, t_int8 = run(int8, in_pad, args.task)
+        fp32_times.append(t_fp32)
+        int8_times.append(t_int8)
+
+        if args.task == 'cls':
+            top1_agree += int(out_fp32[0].ravel().argmax() == out_int8[0].ravel().argmax())
+            continue
+
+        h, w = in_pad.shape[:2]
+        ref = decode(args.task, out_fp32, w, h, args.prob_threshold, args.nms_threshold)
+        test = decode(args.task, out_int8, w, h, args.prob_threshold, args.nms_threshold)
+        n_ref += len(ref['boxes'])
+        n_test += len(test['boxes'])
+        n_matched += match(args.task, ref, test, args.iou_threshold)
+
+    n = len(fp32_times)
+    print('frames            %d' % n)
+    print('fp32 latency      avg %.2f ms  min %.2f ms' % (np.mean(fp32_times), np.min(fp32_times)))
+    print('int8 latency      avg %.2f ms  min %.2f ms' % (np.mean(int8_times), np.min(int8_times)))
+    print('speedup           %.2fx' % (np.mean(fp32_times) / np.mean(int8_times)))
+    if args.task == 'cls':
+        print('top-1 agreement   %.2f%%' % (100.0 * top1_agree / max(n, 1)))
+    else:
+        print('fp32 detections   %d' % n_ref)
+        print('int8 detections   %d' % n_test)
+        measure = {'det': 'box iou', 'seg': 'mask iou', 'pose': 'oks', 'obb': 'rotated iou'}[args.task]
+        print('recall vs fp32    %.2f%%  (%s >= %.2f, same label)' % (100.0 * n_matched / max(n_ref, 1), measure, args.iou_threshold))
+        print('precision vs fp32 %.2f%%' % (100.0 * n_matched / max(n_test, 1)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='yolo11 ncnn int8 calibration and comparison')
+    sub = parser.add_subparsers(dest='command')
+    sub.required = True
+
+    def common(p):
+        p.add_argument('--task', choices=('det', 'seg', 'pose', 'cls', 'obb'), default='det')
+        p.add_argument('--target-size', type=int, default=640, help='det_target_size used on device, 224 for cls')
+        p.add_argument('--threads', type=int, default=os.cpu_count() or 4)
+
+    p = sub.add_parser('calibrate', help='build calibration table and int8 model')
+    p.add_argument('param')
+    p.add_argument('bin')
+    p.add_argument('frames', help='directory of representative replay frames')
+    p.add_argument('--method', choices=('kl', 'aciq', 'eq'), default='kl')
+    p.add_argument('--output', help='output basename, defaults to the fp32 model basename')
+    common(p)
+    p.set_defaults(func=calibrate)
+
+    p = sub.add_parser('report', help='compare int8 against fp32 latency and detections')
+    p.add_argument('param')
+    p.add_argument('bin')
+    p.add_argument('int8_param')
+    p.add_argument('int8_bin')
+    p.add_argument('frames', help='directory of replay frames')
+    p.add_argument('--prob-threshold', type=float, default=0.25)
+    p.add_argument('--nms-threshold', type=float, default=0.45)
+    p.add_argument('--iou-threshold', type=float, default=0.5, help='match threshold on box iou, mask iou for seg, oks for pose, rotated iou for obb')
+    common(p)
+    p.set_defaults(func=report)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == '__main__':
+    main()